@@ -0,0 +1,121 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "background-renderer.h"
+
+#include <QPainter>
+#include <KGameRenderer>
+#include <KGameRendererClient>
+#include <KgTheme>
+
+//number of composed backgrounds kept in the cache
+static const int CachedBackgrounds = 4;
+
+class KDiamond::BackgroundRenderer::Client : public KGameRendererClient
+{
+	public:
+		Client(KDiamond::BackgroundRenderer* owner, KGameRenderer* renderer, const QString& spriteKey)
+			: KGameRendererClient(renderer, spriteKey)
+			, m_owner(owner)
+		{
+		}
+
+		//the pixmap is only valid if it has been rendered for the current render
+		//size with the given theme (a theme change keeps the render size)
+		bool isReady(const QString& theme) const
+		{
+			return !m_pixmap.isNull() && m_pixmap.size() == renderSize() && m_theme == theme;
+		}
+		const QPixmap& pixmap() const
+		{
+			return m_pixmap;
+		}
+	protected:
+		virtual void receivePixmap(const QPixmap& pixmap)
+		{
+			m_pixmap = pixmap;
+			m_theme = renderer()->theme()->identifier();
+			m_owner->clientReceived();
+		}
+	private:
+		KDiamond::BackgroundRenderer* m_owner;
+		QPixmap m_pixmap;
+		QString m_theme;
+};
+
+KDiamond::BackgroundRenderer::BackgroundRenderer(KGameRenderer* renderer, QObject* parent)
+	: QObject(parent)
+	, m_renderer(renderer)
+	, m_background(0)
+	, m_border(0)
+	, m_cache(CachedBackgrounds)
+{
+	m_background = new Client(this, renderer, QLatin1String("kdiamond-background"));
+	m_border = new Client(this, renderer, QLatin1String("kdiamond-border"));
+}
+
+KDiamond::BackgroundRenderer::~BackgroundRenderer()
+{
+	delete m_background;
+	delete m_border;
+}
+
+void KDiamond::BackgroundRenderer::request(const QSize& sceneSize, const QRect& borderRect)
+{
+	//the theme is part of the key, because the cache survives theme changes
+	m_theme = m_renderer->theme()->identifier();
+	m_key = QString::fromLatin1("%1/%2x%3/%4,%5,%6")
+		.arg(m_theme)
+		.arg(sceneSize.width()).arg(sceneSize.height())
+		.arg(borderRect.x()).arg(borderRect.y()).arg(borderRect.width());
+	m_borderRect = borderRect;
+	if (QPixmap* background = m_cache.object(m_key))
+	{
+		//cancel a pending request
+		m_key.clear();
+		emit ready(*background);
+		return;
+	}
+	//setRenderSize() delivers the pixmap right away if the renderer has it cached
+	m_background->setRenderSize(sceneSize);
+	if (!borderRect.isEmpty())
+		m_border->setRenderSize(borderRect.size());
+	clientReceived();
+}
+
+void KDiamond::BackgroundRenderer::clientReceived()
+{
+	//wait until both sprites have been rendered at the requested size and with
+	//the requested theme
+	if (m_key.isEmpty() || !m_background->isReady(m_theme))
+		return;
+	const bool hasBorder = !m_borderRect.isEmpty();
+	if (hasBorder && !m_border->isReady(m_theme))
+		return;
+	QPixmap* background = new QPixmap(m_background->pixmap());
+	if (hasBorder)
+	{
+		QPainter painter(background);
+		painter.drawPixmap(m_borderRect.topLeft(), m_border->pixmap());
+	}
+	m_cache.insert(m_key, background);
+	m_key.clear();
+	emit ready(*background);
+}
+
+#include "background-renderer.moc"
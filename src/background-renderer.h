@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_BACKGROUNDRENDERER_H
+#define KDIAMOND_BACKGROUNDRENDERER_H
+
+#include <QCache>
+#include <QObject>
+#include <QPixmap>
+#include <QRect>
+
+class KGameRenderer;
+
+namespace KDiamond
+{
+	//Composes the scene background (the background sprite with the board
+	//border drawn onto it) without blocking the GUI thread: the sprites are
+	//requested asynchronously, i.e. they are rendered on the worker threads of
+	//the renderer. The composed backgrounds of the last few window sizes are
+	//cached, so that switching back and forth (e.g. maximizing) is instant.
+	class BackgroundRenderer : public QObject
+	{
+		Q_OBJECT
+		public:
+			BackgroundRenderer(KGameRenderer* renderer, QObject* parent = 0);
+			virtual ~BackgroundRenderer();
+
+			//Requests the background for a scene of the given size. The border is
+			//drawn into borderRect (pass an empty rect if the theme has no border).
+			//ready() is emitted when the background is available, which may happen
+			//before this method returns if it is cached.
+			void request(const QSize& sceneSize, const QRect& borderRect);
+		Q_SIGNALS:
+			void ready(const QPixmap& background);
+		private:
+			class Client;
+			void clientReceived();
+
+			KGameRenderer* m_renderer;
+			Client* m_background;
+			Client* m_border;
+			QString m_theme;
+			QString m_key;
+			QRect m_borderRect;
+			QCache<QString, QPixmap> m_cache;
+	};
+}
+
+#endif // KDIAMOND_BACKGROUNDRENDERER_H
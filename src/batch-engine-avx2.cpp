@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+//This file is compiled with -mavx2 (see CMakeLists.txt). Its functions are only
+//called if the CPU supports AVX2 (see KDiamond::BoardBatch::hasAvx2()).
+
+#include "batch-engine.h"
+#include "batch-kernel.h"
+
+#include <immintrin.h>
+
+namespace
+{
+	struct Avx2Ops
+	{
+		typedef __m256i V;
+
+		static V load(const unsigned char* p) { return _mm256_loadu_si256((const __m256i*) p); }
+		static void store(unsigned char* p, V v) { _mm256_storeu_si256((__m256i*) p, v); }
+		static V zero() { return _mm256_setzero_si256(); }
+		static V ones() { return _mm256_set1_epi8(-1); }
+		static V eq(V a, V b) { return _mm256_cmpeq_epi8(a, b); }
+		static V and_(V a, V b) { return _mm256_and_si256(a, b); }
+		static V or_(V a, V b) { return _mm256_or_si256(a, b); }
+		//~a & b
+		static V andnot(V a, V b) { return _mm256_andnot_si256(a, b); }
+		//b where mask is set, otherwise a
+		static V blend(V a, V b, V mask) { return _mm256_blendv_epi8(a, b, mask); }
+		static V sub(V a, V b) { return _mm256_sub_epi8(a, b); }
+		static uint32_t movemask(V a) { return (uint32_t) _mm256_movemask_epi8(a); }
+		static bool any(V a) { return !_mm256_testz_si256(a, a); }
+	};
+}
+
+void KDiamond::BatchAvx2::countMoves(BatchState& state)
+{
+	BatchKernel<Avx2Ops>::countMoves(state);
+}
+
+int KDiamond::BatchAvx2::playRandomMoves(BatchState& state)
+{
+	return BatchKernel<Avx2Ops>::playRandomMoves(state);
+}
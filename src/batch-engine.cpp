@@ -0,0 +1,334 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "batch-engine.h"
+#include "batch-kernel.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	//byte-wise operations with plain loops (which the compiler may still vectorize with SSE2)
+	struct ScalarOps
+	{
+		struct V
+		{
+			unsigned char b[KDiamond::BatchLanes];
+		};
+
+		static V load(const unsigned char* p) { V v; std::memcpy(v.b, p, sizeof(v.b)); return v; }
+		static void store(unsigned char* p, const V& v) { std::memcpy(p, v.b, sizeof(v.b)); }
+		static V zero() { V v; std::memset(v.b, 0, sizeof(v.b)); return v; }
+		static V ones() { V v; std::memset(v.b, 0xff, sizeof(v.b)); return v; }
+		static V eq(const V& a, const V& b)
+		{
+			V v;
+			for (int i = 0; i < KDiamond::BatchLanes; ++i)
+				v.b[i] = a.b[i] == b.b[i] ? 0xff : 0;
+			return v;
+		}
+		static V and_(const V& a, const V& b)
+		{
+			V v;
+			for (int i = 0; i < KDiamond::BatchLanes; ++i)
+				v.b[i] = a.b[i] & b.b[i];
+			return v;
+		}
+		static V or_(const V& a, const V& b)
+		{
+			V v;
+			for (int i = 0; i < KDiamond::BatchLanes; ++i)
+				v.b[i] = a.b[i] | b.b[i];
+			return v;
+		}
+		//~a & b
+		static V andnot(const V& a, const V& b)
+		{
+			V v;
+			for (int i = 0; i < KDiamond::BatchLanes; ++i)
+				v.b[i] = ~a.b[i] & b.b[i];
+			return v;
+		}
+		//b where mask is set, otherwise a
+		static V blend(const V& a, const V& b, const V& mask)
+		{
+			V v;
+			for (int i = 0; i < KDiamond::BatchLanes; ++i)
+				v.b[i] = (a.b[i] & ~mask.b[i]) | (b.b[i] & mask.b[i]);
+			return v;
+		}
+		static V sub(const V& a, const V& b)
+		{
+			V v;
+			for (int i = 0; i < KDiamond::BatchLanes; ++i)
+				v.b[i] = a.b[i] - b.b[i];
+			return v;
+		}
+		static uint32_t movemask(const V& a)
+		{
+			uint32_t mask = 0;
+			for (int i = 0; i < KDiamond::BatchLanes; ++i)
+				mask |= uint32_t(a.b[i] >> 7) << i;
+			return mask;
+		}
+		static bool any(const V& a)
+		{
+			return movemask(a) != 0;
+		}
+	};
+}
+
+void KDiamond::BatchScalar::countMoves(BatchState& state)
+{
+	BatchKernel<ScalarOps>::countMoves(state);
+}
+
+int KDiamond::BatchScalar::playRandomMoves(BatchState& state)
+{
+	return BatchKernel<ScalarOps>::playRandomMoves(state);
+}
+
+#ifndef KDIAMOND_HAVE_AVX2
+//the compiler cannot generate AVX2 code, hasAvx2() is always false
+void KDiamond::BatchAvx2::countMoves(BatchState& state)
+{
+	BatchScalar::countMoves(state);
+}
+
+int KDiamond::BatchAvx2::playRandomMoves(BatchState& state)
+{
+	return BatchScalar::playRandomMoves(state);
+}
+#endif
+
+KDiamond::BoardBatch::BoardBatch(int size, int colorCount)
+	: m_vectorized(hasAvx2())
+{
+	std::memset(&m_state, 0, sizeof(m_state));
+	m_state.size = size;
+	m_state.colorCount = colorCount;
+	seed(1);
+}
+
+bool KDiamond::BoardBatch::hasAvx2()
+{
+#if defined(KDIAMOND_HAVE_AVX2) && defined(__GNUC__)
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+void KDiamond::BoardBatch::setVectorized(bool vectorized)
+{
+	m_vectorized = vectorized && hasAvx2();
+}
+
+void KDiamond::BoardBatch::seed(int seed)
+{
+	//decorrelate the lanes (laneUnifInt() mixes the state, so distinct states suffice)
+	for (int lane = 0; lane < BatchLanes; ++lane)
+		m_state.rng[lane] = (uint64_t(seed) << 32) ^ (uint64_t(lane) * 0xd1b54a32d192ed03ULL);
+}
+
+void KDiamond::BoardBatch::loadLane(int lane, const BoardModel& board)
+{
+	for (int cell = 0; cell < board.cellCount(); ++cell)
+		m_state.colors[cell][lane] = board.color(cell);
+	m_state.moves[lane] = m_state.removed[lane] = m_state.levels[lane] = 0;
+	m_state.points[lane] = m_state.earnedMilliseconds[lane] = 0;
+}
+
+void KDiamond::BoardBatch::load(int lane, const BoardModel& board)
+{
+	loadLane(lane, board);
+	countMoves();
+}
+
+void KDiamond::BoardBatch::load(const std::vector<BoardModel>& boards)
+{
+	const int count = std::min<int>(boards.size(), BatchLanes);
+	for (int lane = 0; lane < count; ++lane)
+		loadLane(lane, boards[lane]);
+	countMoves();
+}
+
+void KDiamond::BoardBatch::store(int lane, BoardModel& board) const
+{
+	for (int cell = 0; cell < board.cellCount(); ++cell)
+		board.setCell(cell, m_state.colors[cell][lane]);
+}
+
+namespace
+{
+	//adapts the generator of a lane to BoardModel::generate()
+	struct LaneRNG
+	{
+		uint64_t& state;
+		int unifInt(int n) { return laneUnifInt(state, n); }
+	};
+}
+
+void KDiamond::BoardBatch::generate()
+{
+	BoardModel board(m_state.size, m_state.colorCount);
+	for (int lane = 0; lane < BatchLanes; ++lane)
+	{
+		LaneRNG rng = { m_state.rng[lane] };
+		board.generate(rng);
+		loadLane(lane, board);
+	}
+	countMoves();
+}
+
+void KDiamond::BoardBatch::countMoves()
+{
+	if (m_vectorized)
+		BatchAvx2::countMoves(m_state);
+	else
+		BatchScalar::countMoves(m_state);
+}
+
+int KDiamond::BoardBatch::playRandomMoves()
+{
+	return m_vectorized ? BatchAvx2::playRandomMoves(m_state) : BatchScalar::playRandomMoves(m_state);
+}
+
+#ifdef UNITTEST
+#include "headless-game.h"
+#include "move-evaluator.h"
+#include <gtest/gtest.h>
+
+TEST(BoardBatch, matchesRules){
+    for(int difficulty = 0; difficulty < KDiamond::DifficultyCount; ++difficulty){
+        KDiamond::BoardBatch batch(KDiamond::boardSize(difficulty), KDiamond::boardColorCount(difficulty));
+        batch.seed(difficulty + 1);
+        batch.generate();
+        KDiamond::BoardModel board(KDiamond::boardSize(difficulty), KDiamond::boardColorCount(difficulty));
+        KDiamond::MoveIndex index;
+        std::vector<KDiamond::Match> figures;
+        for(int step = 0; step < 30; ++step){
+            batch.playRandomMoves();
+            for(int lane = 0; lane < KDiamond::BatchLanes; ++lane){
+                //the cascades are resolved completely, and the legal moves agree with the move index
+                batch.store(lane, board);
+                figures.clear();
+                EXPECT_EQ(0, board.findFigures(figures));
+                index.invalidate();
+                index.update(board);
+                EXPECT_EQ(index.count(), batch.moveCount(lane));
+            }
+        }
+    }
+}
+
+TEST(BoardBatch, scoresLikeMoveEvaluator){
+    for(int difficulty = 0; difficulty < KDiamond::DifficultyCount; ++difficulty){
+        const int size = KDiamond::boardSize(difficulty), colorCount = KDiamond::boardColorCount(difficulty);
+        KDiamond::BoardBatch batch(size, colorCount);
+        batch.seed(difficulty + 7);
+        std::vector<KDiamond::BoardModel> boards(KDiamond::BatchLanes, KDiamond::BoardModel(size, colorCount));
+        uint64_t state = difficulty;
+        for(size_t i = 0; i < boards.size(); ++i){
+            LaneRNG rng = { state };
+            boards[i].generate(rng);
+        }
+        batch.load(boards);
+        KDiamond::MoveEvaluator evaluator;
+        KDiamond::BoardModel board(size, colorCount), played(size, colorCount);
+        for(int step = 0; step < 20; ++step){
+            //replay the move of each lane with its generator: the kernel draws the
+            //move among the legal candidates (cell by cell, right before down),
+            //then the refills in the order of BoardModel::refill
+            KDiamond::MoveResult expected[KDiamond::BatchLanes];
+            uint64_t hashes[KDiamond::BatchLanes], states[KDiamond::BatchLanes];
+            long long points[KDiamond::BatchLanes], earned[KDiamond::BatchLanes];
+            int removed[KDiamond::BatchLanes], levels[KDiamond::BatchLanes], moves[KDiamond::BatchLanes];
+            for(int lane = 0; lane < KDiamond::BatchLanes; ++lane){
+                states[lane] = batch.rngState(lane);
+                batch.store(lane, board);
+                std::vector<KDiamond::Swap> candidates;
+                KDiamond::Swap swap;
+                for(int a = 0; a < board.cellCount(); ++a){
+                    if(board.x(a) < size - 1 && board.evaluateSwap(a, a + 1, swap)){
+                        candidates.push_back(swap);
+                    }
+                    if(board.y(a) < size - 1 && board.evaluateSwap(a, a + size, swap)){
+                        candidates.push_back(swap);
+                    }
+                }
+                ASSERT_EQ((int) candidates.size(), batch.moveCount(lane));
+                const KDiamond::MoveResult none = { 0, 0, 0, 0 };
+                expected[lane] = none;
+                if(!candidates.empty()){
+                    const KDiamond::Swap& move = candidates[laneUnifInt(states[lane], candidates.size())];
+                    board.swapCells(move.from, move.to);
+                    LaneRNG rng = { states[lane] };
+                    expected[lane] = evaluator.resolve(board, rng);
+                }
+                hashes[lane] = board.hash();
+                points[lane] = batch.points(lane);
+                earned[lane] = batch.earnedMilliseconds(lane);
+                removed[lane] = batch.removed(lane);
+                levels[lane] = batch.levels(lane);
+                moves[lane] = batch.moves(lane);
+            }
+            batch.playRandomMoves();
+            for(int lane = 0; lane < KDiamond::BatchLanes; ++lane){
+                EXPECT_EQ(expected[lane].points, batch.points(lane) - points[lane]);
+                EXPECT_EQ(expected[lane].earnedMilliseconds, batch.earnedMilliseconds(lane) - earned[lane]);
+                EXPECT_EQ(expected[lane].removed, batch.removed(lane) - removed[lane]);
+                EXPECT_EQ(expected[lane].levels, batch.levels(lane) - levels[lane]);
+                EXPECT_EQ(expected[lane].levels ? 1 : 0, batch.moves(lane) - moves[lane]);
+                EXPECT_EQ(states[lane], batch.rngState(lane));
+                batch.store(lane, played);
+                EXPECT_EQ(hashes[lane], played.hash());
+            }
+            if(::testing::Test::HasFailure()){
+                return;
+            }
+        }
+    }
+}
+
+TEST(BoardBatch, vectorizedEqualsScalar){
+    if(!KDiamond::BoardBatch::hasAvx2()){
+        return;
+    }
+    KDiamond::BoardBatch scalar(8, 6), vectorized(8, 6);
+    scalar.setVectorized(false);
+    vectorized.setVectorized(true);
+    scalar.seed(4711);
+    vectorized.seed(4711);
+    scalar.generate();
+    vectorized.generate();
+    KDiamond::BoardModel board1(8, 6), board2(8, 6);
+    for(int step = 0; step < 200; ++step){
+        EXPECT_EQ(scalar.playRandomMoves(), vectorized.playRandomMoves());
+    }
+    for(int lane = 0; lane < KDiamond::BatchLanes; ++lane){
+        EXPECT_EQ(scalar.points(lane), vectorized.points(lane));
+        EXPECT_EQ(scalar.moves(lane), vectorized.moves(lane));
+        EXPECT_EQ(scalar.levels(lane), vectorized.levels(lane));
+        scalar.store(lane, board1);
+        vectorized.store(lane, board2);
+        EXPECT_EQ(board1.hash(), board2.hash());
+    }
+}
+#endif //UNITTEST
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_BATCHENGINE_H
+#define KDIAMOND_BATCHENGINE_H
+
+#include "board-model.h"
+
+namespace KDiamond
+{
+	const int BatchLanes = 32;
+
+	//State of KDiamond::BoardBatch, shared with the kernels in batch-kernel.h.
+	//The colors are stored as structure of arrays: colors[cell][lane] holds
+	//the color of a cell on all boards, such that one 256-bit vector holds the
+	//same cell of 32 boards.
+	struct BatchState
+	{
+		alignas(32) unsigned char colors[MaxCellCount][BatchLanes];
+		uint64_t rng[BatchLanes];
+		int size, colorCount;
+		//statistics per lane (see KDiamond::BoardBatch)
+		int moveCount[BatchLanes], moves[BatchLanes], removed[BatchLanes], levels[BatchLanes];
+		long long points[BatchLanes], earnedMilliseconds[BatchLanes];
+		//candidate swaps (with the right or lower neighbor) and the lanes on which they are legal
+		int candidateCount;
+		int candidates[2 * MaxCellCount][2];
+		uint32_t legal[2 * MaxCellCount];
+	};
+
+	//Plays 32 independent games in lock-step, e.g. for the rollouts of Monte
+	//Carlo searches. The rules of KDiamond::MoveEvaluator (figure detection,
+	//gravity and refills) are applied to all boards at once with byte-wise
+	//vector compares: with AVX2, one compare handles a cell on all 32 boards.
+	//On machines without AVX2, a scalar kernel with identical results is used.
+	//
+	//Jollies are not supported (they only appear in the GUI). The refills come
+	//from one generator stream per lane, which is different from the refills
+	//of KDiamond::HeadlessGame for the same seed.
+	class BoardBatch
+	{
+		public:
+			BoardBatch(int size, int colorCount);
+
+			//whether the AVX2 kernel is used (by default if the CPU supports it)
+			bool isVectorized() const { return m_vectorized; }
+			//selects the kernel (e.g. for comparisons); AVX2 is only used if available
+			void setVectorized(bool vectorized);
+			static bool hasAvx2();
+
+			//Copies a board into a lane and resets the statistics of the lane. The
+			//board must not contain figures. This counts the moves of all lanes, so
+			//use the other overload to fill several lanes.
+			void load(int lane, const BoardModel& board);
+			//copies the boards into the lanes 0, 1, ... (at most BatchLanes boards)
+			void load(const std::vector<BoardModel>& boards);
+			void store(int lane, BoardModel& board) const;
+			//fills all lanes with random boards (see KDiamond::BoardModel::generate)
+			void generate();
+			void seed(int seed);
+
+			//Plays a random legal move on each lane which has one, and resolves the
+			//cascades. Returns the number of lanes which have played a move.
+			int playRandomMoves();
+
+			//number of legal moves of the lane (0 if the game is finished)
+			int moveCount(int lane) const { return m_state.moveCount[lane]; }
+			int moves(int lane) const { return m_state.moves[lane]; }
+			int removed(int lane) const { return m_state.removed[lane]; }
+			int levels(int lane) const { return m_state.levels[lane]; }
+			long long points(int lane) const { return m_state.points[lane]; }
+			long long earnedMilliseconds(int lane) const { return m_state.earnedMilliseconds[lane]; }
+			//state of the generator of the lane, which draws the moves and refills
+			uint64_t rngState(int lane) const { return m_state.rng[lane]; }
+		private:
+			void loadLane(int lane, const BoardModel& board);
+			void countMoves();
+
+			BatchState m_state;
+			bool m_vectorized;
+	};
+
+	//kernels of KDiamond::BoardBatch (see batch-kernel.h)
+	namespace BatchScalar
+	{
+		void countMoves(BatchState& state);
+		int playRandomMoves(BatchState& state);
+	}
+	namespace BatchAvx2
+	{
+		void countMoves(BatchState& state);
+		int playRandomMoves(BatchState& state);
+	}
+}
+
+#endif // KDIAMOND_BATCHENGINE_H
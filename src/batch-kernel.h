@@ -0,0 +1,262 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_BATCHKERNEL_H
+#define KDIAMOND_BATCHKERNEL_H
+
+#include "batch-engine.h"
+
+//The rules of KDiamond::BoardBatch, written once against a small set of vector
+//operations on 32 bytes (one byte per lane). batch-engine.cpp instantiates
+//them with scalar loops, batch-engine-avx2.cpp with AVX2 intrinsics.
+//
+//NOTE: This header is compiled with different instruction sets. Everything in
+//here must have internal linkage, and no standard library templates may be
+//used, since the linker could otherwise pick an AVX2 instance of them for the
+//scalar code.
+
+namespace
+{
+	//generator of one lane (SplitMix64)
+	inline int laneUnifInt(uint64_t& state, int n)
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		z ^= z >> 31;
+		return (int) (((z >> 32) * (uint64_t) n) >> 32);
+	}
+
+	template<class Ops> struct BatchKernel
+	{
+		typedef typename Ops::V V;
+
+		static V load(const KDiamond::BatchState& s, int cell)
+		{
+			return Ops::load(s.colors[cell]);
+		}
+
+		//Marks the cells which are part of a figure, i.e. of three equal colors
+		//in a row or column. Returns the lanes which have figures.
+		static V markFigures(const KDiamond::BatchState& s, V* marks)
+		{
+			const int size = s.size;
+			const V zero = Ops::zero();
+			for (int cell = 0; cell < size * size; ++cell)
+				marks[cell] = zero;
+			V lanes = zero;
+			for (int y = 0; y < size; ++y)
+				for (int x = 0; x < size; ++x)
+				{
+					const int cell = x + y * size;
+					const V c0 = load(s, cell);
+					const V nonEmpty = Ops::andnot(Ops::eq(c0, zero), Ops::ones());
+					if (x < size - 2)
+					{
+						const V c1 = load(s, cell + 1), c2 = load(s, cell + 2);
+						const V m = Ops::and_(nonEmpty, Ops::and_(Ops::eq(c0, c1), Ops::eq(c1, c2)));
+						marks[cell] = Ops::or_(marks[cell], m);
+						marks[cell + 1] = Ops::or_(marks[cell + 1], m);
+						marks[cell + 2] = Ops::or_(marks[cell + 2], m);
+						lanes = Ops::or_(lanes, m);
+					}
+					if (y < size - 2)
+					{
+						const V c1 = load(s, cell + size), c2 = load(s, cell + 2 * size);
+						const V m = Ops::and_(nonEmpty, Ops::and_(Ops::eq(c0, c1), Ops::eq(c1, c2)));
+						marks[cell] = Ops::or_(marks[cell], m);
+						marks[cell + size] = Ops::or_(marks[cell + size], m);
+						marks[cell + 2 * size] = Ops::or_(marks[cell + 2 * size], m);
+						lanes = Ops::or_(lanes, m);
+					}
+				}
+			return lanes;
+		}
+
+		//empties the marked cells and adds the number of removed diamonds per lane to removed
+		static void removeMarked(KDiamond::BatchState& s, const V* marks, int* removed)
+		{
+			const V zero = Ops::zero();
+			//byte counters suffice, since at most MaxCellCount < 256 cells are removed at once
+			V count = zero;
+			for (int cell = 0; cell < s.size * s.size; ++cell)
+			{
+				Ops::store(s.colors[cell], Ops::blend(load(s, cell), zero, marks[cell]));
+				count = Ops::sub(count, marks[cell]);
+			}
+			alignas(32) unsigned char counts[KDiamond::BatchLanes];
+			Ops::store(counts, count);
+			for (int lane = 0; lane < KDiamond::BatchLanes; ++lane)
+				removed[lane] += counts[lane];
+		}
+
+		//Moves the diamonds down into the empty cells below them. Each pass moves
+		//all diamonds above a gap down by one cell.
+		static void collapse(KDiamond::BatchState& s)
+		{
+			const int size = s.size;
+			const V zero = Ops::zero();
+			while (true)
+			{
+				V moved = zero;
+				for (int y = size - 1; y > 0; --y)
+					for (int x = 0; x < size; ++x)
+					{
+						const int below = x + y * size, above = below - size;
+						const V b = load(s, below), a = load(s, above);
+						const V m = Ops::andnot(Ops::eq(a, zero), Ops::eq(b, zero));
+						Ops::store(s.colors[below], Ops::blend(b, a, m));
+						Ops::store(s.colors[above], Ops::blend(a, zero, m));
+						moved = Ops::or_(moved, m);
+					}
+				if (!Ops::any(moved))
+					break;
+			}
+		}
+
+		//Fills the empty cells with random colors from the generator of their
+		//lane. The cells are visited in the order of BoardModel::refill (column by
+		//column, from the bottom up), so that each lane draws the same colors as a
+		//BoardModel with the generator of the lane.
+		static void refill(KDiamond::BatchState& s)
+		{
+			const int size = s.size;
+			const V zero = Ops::zero();
+			for (int x = 0; x < size; ++x)
+				for (int y = size - 1; y >= 0; --y)
+				{
+					const int cell = x + y * size;
+					uint32_t empty = Ops::movemask(Ops::eq(load(s, cell), zero));
+					while (empty)
+					{
+						const int lane = __builtin_ctz(empty);
+						empty &= empty - 1;
+						s.colors[cell][lane] = 1 + laneUnifInt(s.rng[lane], s.colorCount);
+					}
+				}
+		}
+
+		//Lanes on which the cell p forms a figure if it gets the color c. The
+		//cell q (the swap partner of p) has the color cq meanwhile.
+		static V formsFigure(const KDiamond::BatchState& s, int p, V c, int q, V cq)
+		{
+			const int size = s.size, px = p % size, py = p / size;
+			static const int offsets[3][2] = { { -2, -1 }, { -1, 1 }, { 1, 2 } };
+			V result = Ops::zero();
+			for (int i = 0; i < 3; ++i)
+			{
+				const int u = offsets[i][0], w = offsets[i][1];
+				if (px + u >= 0 && px + w < size)
+				{
+					const V cu = p + u == q ? cq : load(s, p + u);
+					const V cw = p + w == q ? cq : load(s, p + w);
+					result = Ops::or_(result, Ops::and_(Ops::eq(cu, c), Ops::eq(cw, c)));
+				}
+				if (py + u >= 0 && py + w < size)
+				{
+					const V cu = p + u * size == q ? cq : load(s, p + u * size);
+					const V cw = p + w * size == q ? cq : load(s, p + w * size);
+					result = Ops::or_(result, Ops::and_(Ops::eq(cu, c), Ops::eq(cw, c)));
+				}
+			}
+			return Ops::andnot(Ops::eq(c, Ops::zero()), result);
+		}
+
+		static void countMoves(KDiamond::BatchState& s)
+		{
+			const int size = s.size;
+			int k = 0;
+			for (int a = 0; a < size * size; ++a)
+				for (int direction = 0; direction < 2; ++direction)
+				{
+					const int x = a % size, y = a / size;
+					if ((direction == 0 && x == size - 1) || (direction == 1 && y == size - 1))
+						continue;
+					const int b = direction == 0 ? a + 1 : a + size;
+					const V ca = load(s, a), cb = load(s, b);
+					const V legal = Ops::or_(formsFigure(s, a, cb, b, ca), formsFigure(s, b, ca, a, cb));
+					s.candidates[k][0] = a;
+					s.candidates[k][1] = b;
+					s.legal[k++] = Ops::movemask(legal);
+				}
+			s.candidateCount = k;
+			for (int lane = 0; lane < KDiamond::BatchLanes; ++lane)
+				s.moveCount[lane] = 0;
+			for (int i = 0; i < k; ++i)
+				for (uint32_t lanes = s.legal[i]; lanes; lanes &= lanes - 1)
+					++s.moveCount[__builtin_ctz(lanes)];
+		}
+
+		static int playRandomMoves(KDiamond::BatchState& s)
+		{
+			//choose a random legal move on each lane (in the order of the candidates)
+			int pick[KDiamond::BatchLanes], chosen[KDiamond::BatchLanes];
+			for (int lane = 0; lane < KDiamond::BatchLanes; ++lane)
+			{
+				chosen[lane] = -1;
+				pick[lane] = s.moveCount[lane] ? laneUnifInt(s.rng[lane], s.moveCount[lane]) : -1;
+			}
+			for (int i = 0; i < s.candidateCount; ++i)
+				for (uint32_t lanes = s.legal[i]; lanes; lanes &= lanes - 1)
+				{
+					const int lane = __builtin_ctz(lanes);
+					if (pick[lane]-- == 0)
+						chosen[lane] = i;
+				}
+			int played = 0;
+			for (int lane = 0; lane < KDiamond::BatchLanes; ++lane)
+			{
+				if (chosen[lane] < 0)
+					continue;
+				unsigned char* a = &s.colors[s.candidates[chosen[lane]][0]][lane];
+				unsigned char* b = &s.colors[s.candidates[chosen[lane]][1]][lane];
+				const unsigned char color = *a;
+				*a = *b;
+				*b = color;
+				++s.moves[lane];
+				++played;
+			}
+			//resolve the cascades on all lanes at once
+			V marks[KDiamond::MaxCellCount];
+			int removed[KDiamond::BatchLanes] = {};
+			while (true)
+			{
+				const V lanes = markFigures(s, marks);
+				if (!Ops::any(lanes))
+					break;
+				for (uint32_t m = Ops::movemask(lanes); m; m &= m - 1)
+					++s.levels[__builtin_ctz(m)];
+				removeMarked(s, marks, removed);
+				collapse(s);
+				refill(s);
+			}
+			//see KDiamond::GameState::addPoints, which is called once per removed diamond
+			for (int lane = 0; lane < KDiamond::BatchLanes; ++lane)
+			{
+				const long long n = removed[lane];
+				s.removed[lane] += n;
+				s.points[lane] += n * (n + 1) / 2;
+				s.earnedMilliseconds[lane] += 500 * n;
+			}
+			countMoves(s);
+			return played;
+		}
+	};
+}
+
+#endif // KDIAMOND_BATCHKERNEL_H
@@ -0,0 +1,280 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "batch-engine.h"
+#include "board-model.h"
+#include "headless-game.h"
+#include "move-index.h"
+#include "rng.h"
+#include "strategy.h"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+
+//Micro-benchmarks of the game kernels on every difficulty level. The GUI
+//classes delegate to these kernels:
+//
+//    Board::Board          BoardModel::generate
+//    Board::fillGaps       BoardModel::collapse + BoardModel::refill
+//    Game::findFigures     BoardModel::findFigures
+//    Game::findFigure      BoardModel::findFigure
+//    Game::getMoves        MoveIndex::update (BoardModel::findSwaps without the index)
+//
+//Use --benchmark_format=json or --benchmark_out=FILE for machine-readable results.
+
+namespace
+{
+	const int PoolSize = 64;
+
+	//Positions from the middle of random games, so that the benchmarks see
+	//realistic boards instead of freshly generated ones.
+	struct Positions
+	{
+		//boards without figures, as seen before a move
+		std::vector<KDiamond::BoardModel> settled;
+		//the same boards right after a legal swap, before the figures are removed
+		std::vector<KDiamond::BoardModel> swapped;
+		std::vector<KDiamond::Swap> swaps;
+	};
+
+	const Positions& positions(int difficultyIndex)
+	{
+		static Positions pool[KDiamond::DifficultyCount];
+		Positions& result = pool[difficultyIndex];
+		if (!result.settled.empty())
+			return result;
+		KDiamond::HeadlessGame game(difficultyIndex);
+		KDiamond::RandomStrategy strategy(4711);
+		//one generator for all games, so the pool is the same in every run
+		cpputils::ParRap rng(1);
+		while ((int) result.settled.size() < PoolSize)
+		{
+			game.start(rng);
+			for (int i = 0; i < 10 && !game.isFinished(); ++i)
+				game.play(strategy.chooseMove(game), rng);
+			if (game.isFinished())
+				continue;
+			const KDiamond::Swap swap = game.moves()[strategy.chooseMove(game)];
+			KDiamond::BoardModel board = game.board();
+			result.settled.push_back(board);
+			board.swapCells(swap.from, swap.to);
+			result.swapped.push_back(board);
+			result.swaps.push_back(swap);
+		}
+		return result;
+	}
+
+	void setLabel(benchmark::State& state, int difficultyIndex)
+	{
+		char label[32];
+		std::snprintf(label, sizeof(label), "%dx%d/%d colors", KDiamond::boardSize(difficultyIndex),
+			KDiamond::boardSize(difficultyIndex), KDiamond::boardColorCount(difficultyIndex));
+		state.SetLabel(label);
+	}
+}
+
+static void BM_Generate(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	cpputils::ParRap rng(1);
+	KDiamond::BoardModel board(KDiamond::boardSize(difficultyIndex), KDiamond::boardColorCount(difficultyIndex));
+	for (auto _ : state)
+	{
+		board.generate(rng);
+		benchmark::DoNotOptimize(board);
+	}
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_Generate)->DenseRange(0, KDiamond::DifficultyCount - 1);
+
+static void BM_FindFigures(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	const Positions& p = positions(difficultyIndex);
+	std::vector<KDiamond::Match> figures;
+	int i = 0;
+	for (auto _ : state)
+	{
+		figures.clear();
+		benchmark::DoNotOptimize(p.swapped[i].findFigures(figures));
+		i = (i + 1) % PoolSize;
+	}
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_FindFigures)->DenseRange(0, KDiamond::DifficultyCount - 1);
+
+//findFigure() on every cell of a board
+static void BM_FindFigure(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	const Positions& p = positions(difficultyIndex);
+	KDiamond::Match figure;
+	int i = 0;
+	for (auto _ : state)
+	{
+		const KDiamond::BoardModel& board = p.swapped[i];
+		for (int index = 0; index < board.cellCount(); ++index)
+			benchmark::DoNotOptimize(board.findFigure(index, figure));
+		i = (i + 1) % PoolSize;
+	}
+	state.SetItemsProcessed(state.iterations() * p.swapped[0].cellCount());
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_FindFigure)->DenseRange(0, KDiamond::DifficultyCount - 1);
+
+//all legal swaps of a board, evaluated from scratch
+static void BM_FindSwaps(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	const Positions& p = positions(difficultyIndex);
+	std::vector<KDiamond::Swap> swaps;
+	int i = 0;
+	for (auto _ : state)
+	{
+		swaps.clear();
+		benchmark::DoNotOptimize(p.settled[i].findSwaps(swaps));
+		i = (i + 1) % PoolSize;
+	}
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_FindSwaps)->DenseRange(0, KDiamond::DifficultyCount - 1);
+
+//removal of the figures formed by a swap, followed by Board::fillGaps
+static void BM_CollapseRefill(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	const Positions& p = positions(difficultyIndex);
+	cpputils::ParRap rng(1);
+	std::vector<KDiamond::Match> figures;
+	std::vector<KDiamond::Drop> drops;
+	int i = 0;
+	for (auto _ : state)
+	{
+		//the copy is part of the measurement, but small compared to the rest
+		KDiamond::BoardModel board = p.swapped[i];
+		figures.clear();
+		board.findFigures(figures);
+		for (size_t j = 0; j < figures.size(); ++j)
+			for (int k = 0; k < figures[j].count; ++k)
+				if (!board.isEmpty(figures[j].cells[k]))
+					board.removeCell(figures[j].cells[k]);
+		drops.clear();
+		board.collapse(&drops);
+		board.refill(rng, &drops);
+		benchmark::DoNotOptimize(board);
+		i = (i + 1) % PoolSize;
+	}
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_CollapseRefill)->DenseRange(0, KDiamond::DifficultyCount - 1);
+
+//a complete move including the cascade and the incremental update of the moves
+//(what Game does between two moves, without the animations)
+static void BM_PlayMove(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	KDiamond::HeadlessGame game(difficultyIndex);
+	KDiamond::RandomStrategy strategy(4711);
+	cpputils::ParRap rng(1);
+	game.start(rng);
+	for (auto _ : state)
+	{
+		if (game.isFinished())
+		{
+			state.PauseTiming();
+			game.start(rng);
+			state.ResumeTiming();
+		}
+		benchmark::DoNotOptimize(game.play(strategy.chooseMove(game), rng));
+	}
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_PlayMove)->DenseRange(0, KDiamond::DifficultyCount - 1);
+
+//full-cascade evaluation of all available moves (as in Game::getMoves)
+static void BM_EvaluateMoves(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	KDiamond::HeadlessGame game(difficultyIndex);
+	cpputils::ParRap rng(1);
+	game.start(rng);
+	KDiamond::MoveEvaluator evaluator;
+	KDiamond::MaskedRefills refills;
+	for (auto _ : state)
+		for (size_t i = 0; i < game.moves().size(); ++i)
+			benchmark::DoNotOptimize(evaluator.evaluate(game.board(), game.moves()[i], refills).result.points);
+	state.SetItemsProcessed(state.iterations() * game.moves().size());
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_EvaluateMoves)->DenseRange(0, KDiamond::DifficultyCount - 1);
+
+//random moves on 32 boards in lock-step, with the scalar (0) and the AVX2 (1) kernel
+static void BM_BatchRandomMoves(benchmark::State& state)
+{
+	const int difficultyIndex = state.range(0);
+	KDiamond::BoardBatch batch(KDiamond::boardSize(difficultyIndex), KDiamond::boardColorCount(difficultyIndex));
+	batch.setVectorized(state.range(1));
+	if (state.range(1) && !batch.isVectorized())
+	{
+		state.SkipWithError("AVX2 is not available");
+		return;
+	}
+	batch.generate();
+	long long moves = 0;
+	for (auto _ : state)
+	{
+		const int played = batch.playRandomMoves();
+		moves += played;
+		if (played < KDiamond::BatchLanes / 2)
+		{
+			state.PauseTiming();
+			batch.generate();
+			state.ResumeTiming();
+		}
+	}
+	state.SetItemsProcessed(moves);
+	setLabel(state, difficultyIndex);
+}
+BENCHMARK(BM_BatchRandomMoves)->ArgsProduct({ { 0, 2, 4 }, { 0, 1 } });
+
+//the rng.h generators, directly and through the RandomSource interface used by Game
+template<class RNG> static void BM_UnifInt(benchmark::State& state)
+{
+	RNG rng(1);
+	const int colorCount = state.range(0);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(rng.unifInt(colorCount));
+}
+BENCHMARK_TEMPLATE(BM_UnifInt, cpputils::ParRap)->DenseRange(5, 7);
+BENCHMARK_TEMPLATE(BM_UnifInt, cpputils::RandomSourceOf<cpputils::ParRap>)->DenseRange(5, 7);
+#ifdef RANDOMLIB
+BENCHMARK_TEMPLATE(BM_UnifInt, cpputils::MarsTwist)->DenseRange(5, 7);
+#endif //RANDOMLIB
+
+template<class RNG> static void BM_UnifReal(benchmark::State& state)
+{
+	RNG rng(1);
+	for (auto _ : state)
+		benchmark::DoNotOptimize(rng.unifReal());
+}
+BENCHMARK_TEMPLATE(BM_UnifReal, cpputils::ParRap);
+#ifdef RANDOMLIB
+BENCHMARK_TEMPLATE(BM_UnifReal, cpputils::MarsTwist);
+#endif //RANDOMLIB
+
+BENCHMARK_MAIN();
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_BITBOARD_H
+#define KDIAMOND_BITBOARD_H
+
+#include <stdint.h>
+
+namespace KDiamond
+{
+	//A set of board cells with one bit per cell (bit i corresponds to the cell
+	//with index i in KDiamond::BoardModel). A single word covers the 8x8
+	//boards, two words cover 10x10 and three words cover 12x12.
+	template<int W> struct BitBoard
+	{
+		uint64_t w[W];
+
+		static BitBoard load(const uint64_t* words)
+		{
+			BitBoard b;
+			for (int i = 0; i < W; ++i)
+				b.w[i] = words[i];
+			return b;
+		}
+		static BitBoard single(int bit)
+		{
+			BitBoard b = {};
+			b.w[bit >> 6] = uint64_t(1) << (bit & 63);
+			return b;
+		}
+
+		bool any() const
+		{
+			uint64_t result = 0;
+			for (int i = 0; i < W; ++i)
+				result |= w[i];
+			return result != 0;
+		}
+		bool test(int bit) const
+		{
+			return (w[bit >> 6] >> (bit & 63)) & 1;
+		}
+		int count() const
+		{
+			int result = 0;
+			for (int i = 0; i < W; ++i)
+				result += __builtin_popcountll(w[i]);
+			return result;
+		}
+		//index of the lowest set bit; must not be called on an empty set
+		int lowest() const
+		{
+			for (int i = 0; i < W - 1; ++i)
+				if (w[i])
+					return (i << 6) + __builtin_ctzll(w[i]);
+			return ((W - 1) << 6) + __builtin_ctzll(w[W - 1]);
+		}
+		//removes and returns the lowest set bit
+		int takeLowest()
+		{
+			for (int i = 0; i < W; ++i)
+				if (w[i])
+				{
+					const int bit = __builtin_ctzll(w[i]);
+					w[i] &= w[i] - 1;
+					return (i << 6) + bit;
+				}
+			return -1;
+		}
+
+		//shift towards higher cell indices (0 < n < 64)
+		BitBoard operator<<(int n) const
+		{
+			BitBoard b;
+			for (int i = W - 1; i > 0; --i)
+				b.w[i] = (w[i] << n) | (w[i - 1] >> (64 - n));
+			b.w[0] = w[0] << n;
+			return b;
+		}
+		//shift towards lower cell indices (0 < n < 64)
+		BitBoard operator>>(int n) const
+		{
+			BitBoard b;
+			for (int i = 0; i < W - 1; ++i)
+				b.w[i] = (w[i] >> n) | (w[i + 1] << (64 - n));
+			b.w[W - 1] = w[W - 1] >> n;
+			return b;
+		}
+		BitBoard operator&(const BitBoard& other) const
+		{
+			BitBoard b;
+			for (int i = 0; i < W; ++i)
+				b.w[i] = w[i] & other.w[i];
+			return b;
+		}
+		BitBoard operator|(const BitBoard& other) const
+		{
+			BitBoard b;
+			for (int i = 0; i < W; ++i)
+				b.w[i] = w[i] | other.w[i];
+			return b;
+		}
+		BitBoard operator~() const
+		{
+			BitBoard b;
+			for (int i = 0; i < W; ++i)
+				b.w[i] = ~w[i];
+			return b;
+		}
+		BitBoard& operator|=(const BitBoard& other)
+		{
+			for (int i = 0; i < W; ++i)
+				w[i] |= other.w[i];
+			return *this;
+		}
+		BitBoard& operator&=(const BitBoard& other)
+		{
+			for (int i = 0; i < W; ++i)
+				w[i] &= other.w[i];
+			return *this;
+		}
+		bool operator==(const BitBoard& other) const
+		{
+			for (int i = 0; i < W; ++i)
+				if (w[i] != other.w[i])
+					return false;
+			return true;
+		}
+		bool operator!=(const BitBoard& other) const
+		{
+			return !(*this == other);
+		}
+	};
+}
+
+#endif // KDIAMOND_BITBOARD_H
@@ -0,0 +1,89 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "board-animator.h"
+#include "diamond.h"
+
+KDiamond::BoardAnimator::BoardAnimator(QObject* parent)
+	: QAbstractAnimation(parent)
+	, m_end(0)
+{
+}
+
+int KDiamond::BoardAnimator::duration() const
+{
+	return m_end;
+}
+
+void KDiamond::BoardAnimator::addMove(Diamond* diamond, const QPointF& from, const QPointF& to, int duration)
+{
+	const Track track = { diamond, 0, duration, false, from, to };
+	addTrack(track);
+}
+
+void KDiamond::BoardAnimator::addRemoval(Diamond* diamond, int duration)
+{
+	const Track track = { diamond, 0, duration, true, QPointF(), QPointF() };
+	addTrack(track);
+}
+
+void KDiamond::BoardAnimator::addTrack(const Track& track)
+{
+	//tracks start at the current time of the animator
+	const bool running = state() != QAbstractAnimation::Stopped;
+	m_tracks << track;
+	Track& added = m_tracks.last();
+	added.start = running ? currentTime() : 0;
+	m_end = qMax(m_end, added.start + added.duration);
+	if (!running)
+		start();
+}
+
+QVector<Diamond*> KDiamond::BoardAnimator::removedDiamonds() const
+{
+	QVector<Diamond*> result;
+	for (int i = 0; i < m_tracks.size(); ++i)
+		if (m_tracks[i].removal)
+			result << m_tracks[i].diamond;
+	return result;
+}
+
+void KDiamond::BoardAnimator::clear()
+{
+	m_tracks.clear();
+	m_end = 0;
+}
+
+void KDiamond::BoardAnimator::updateCurrentTime(int currentTime)
+{
+	for (int i = 0; i < m_tracks.size(); ++i)
+	{
+		const Track& track = m_tracks[i];
+		const int elapsed = currentTime - track.start;
+		const qreal progress = (track.duration <= 0 || elapsed >= track.duration) ? 1.0 : qMax(0, elapsed) / qreal(track.duration);
+		if (track.removal)
+		{
+			if (progress >= 1.0)
+				track.diamond->hide();
+			else
+				track.diamond->setFrame(progress * (track.diamond->frameCount() - 1));
+		}
+		else
+			track.diamond->setPos(track.from + (track.to - track.from) * progress);
+	}
+}
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_BOARDANIMATOR_H
+#define KDIAMOND_BOARDANIMATOR_H
+
+#include <QAbstractAnimation>
+#include <QPointF>
+#include <QVector>
+
+class Diamond;
+
+namespace KDiamond
+{
+	//Drives all animations of a KDiamond::Board with a single time source:
+	//movements of diamonds and remove animations (through all frames of the
+	//diamond sprite). Tracks can be added while the animator is running. The
+	//animator emits finished() once all tracks have been completed.
+	class BoardAnimator : public QAbstractAnimation
+	{
+		public:
+			explicit BoardAnimator(QObject* parent = 0);
+
+			void addMove(Diamond* diamond, const QPointF& from, const QPointF& to, int duration);
+			//The diamond is hidden at the end of the animation. It is kept in
+			//removedDiamonds() until clear() is called.
+			void addRemoval(Diamond* diamond, int duration);
+			bool isActive() const { return !m_tracks.isEmpty(); }
+			QVector<Diamond*> removedDiamonds() const;
+			//forgets all tracks; must not be called while the animator is running
+			void clear();
+
+			virtual int duration() const;
+		protected:
+			virtual void updateCurrentTime(int currentTime);
+		private:
+			struct Track
+			{
+				Diamond* diamond;
+				int start, duration;
+				bool removal;
+				QPointF from, to;
+			};
+			void addTrack(const Track& track);
+
+			QVector<Track> m_tracks;
+			int m_end;
+	};
+}
+
+#endif // KDIAMOND_BOARDANIMATOR_H
@@ -0,0 +1,618 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "board-model.h"
+#include "bitboard.h"
+#include "swap-patterns.h"
+
+#include <cstring>
+
+//NOTE: The corresponding difficulty values are {20, 30, 40, 50, 60} (see KgDifficultyLevel::StandardLevel).
+static const int boardSizes[] = { 12, 10, 8, 8, 8 };
+static const int boardColorCounts[] = { 5, 5, 5, 6, 7 };
+
+int KDiamond::boardSize(int difficultyIndex)
+{
+	return boardSizes[difficultyIndex];
+}
+
+int KDiamond::boardColorCount(int difficultyIndex)
+{
+	return boardColorCounts[difficultyIndex];
+}
+
+//BEGIN bitboard geometry
+
+namespace
+{
+	//Cell masks for one board size. Bitboards use the cell index as bit index,
+	//i.e. one row of the board occupies size consecutive bits.
+	struct Geometry
+	{
+		uint64_t valid[KDiamond::PlaneWords];
+		uint64_t notFirstColumn[KDiamond::PlaneWords];
+		uint64_t notLastColumn[KDiamond::PlaneWords];
+		uint64_t tripleStart[KDiamond::PlaneWords]; //cells where a horizontal triple can start (x < size - 2)
+	};
+
+	bool initGeometries(Geometry* geometries)
+	{
+		std::memset(geometries, 0, (KDiamond::MaxBoardSize + 1) * sizeof(Geometry));
+		for (int size = 1; size <= KDiamond::MaxBoardSize; ++size)
+		{
+			Geometry& g = geometries[size];
+			for (int index = 0; index < size * size; ++index)
+			{
+				const int x = index % size, word = index >> 6;
+				const uint64_t bit = uint64_t(1) << (index & 63);
+				g.valid[word] |= bit;
+				if (x > 0)
+					g.notFirstColumn[word] |= bit;
+				if (x < size - 1)
+					g.notLastColumn[word] |= bit;
+				if (x < size - 2)
+					g.tripleStart[word] |= bit;
+			}
+		}
+		return true;
+	}
+
+	const Geometry& geometry(int size)
+	{
+		static Geometry geometries[KDiamond::MaxBoardSize + 1];
+		static const bool initialized = initGeometries(geometries);
+		(void) initialized;
+		return geometries[size];
+	}
+
+	//figure detection on the bitboard of a single color
+	template<int W> struct FigureKernel
+	{
+		typedef KDiamond::BitBoard<W> BB;
+		BB notFirstColumn, notLastColumn, tripleStart;
+		int stride;
+
+		FigureKernel(int size)
+			: stride(size)
+		{
+			const Geometry& g = geometry(size);
+			notFirstColumn = BB::load(g.notFirstColumn);
+			notLastColumn = BB::load(g.notLastColumn);
+			tripleStart = BB::load(g.tripleStart);
+		}
+
+		//cells that are part of a horizontal row of at least three
+		BB rowsH(const BB& b) const
+		{
+			const BB t = b & (b >> 1) & (b >> 2) & tripleStart;
+			return t | (t << 1) | (t << 2);
+		}
+		//cells that are part of a vertical row of at least three
+		BB rowsV(const BB& b) const
+		{
+			const BB t = b & (b >> stride) & (b >> 2 * stride);
+			return t | (t << stride) | (t << 2 * stride);
+		}
+		//cells at most two steps away from the given ones along rows and columns
+		BB crossNeighborhood(const BB& b, const BB& valid) const
+		{
+			BB h = b | ((b << 1) & notFirstColumn) | ((b >> 1) & notLastColumn);
+			h = h | ((h << 1) & notFirstColumn) | ((h >> 1) & notLastColumn);
+			const BB v = b | (b << stride) | (b >> stride) | (b << 2 * stride) | (b >> 2 * stride);
+			return (h | v) & valid;
+		}
+		//extends the seeds to the complete rows containing them
+		BB growH(BB seeds, const BB& rows) const
+		{
+			while (true)
+			{
+				const BB grown = (seeds | ((seeds << 1) & notFirstColumn) | ((seeds >> 1) & notLastColumn)) & rows;
+				if (grown == seeds)
+					return seeds;
+				seeds = grown;
+			}
+		}
+		BB growV(BB seeds, const BB& rows) const
+		{
+			while (true)
+			{
+				const BB grown = (seeds | (seeds << stride) | (seeds >> stride)) & rows;
+				if (grown == seeds)
+					return seeds;
+				seeds = grown;
+			}
+		}
+		//Collects all rows connected to the seed cell through crossing cells.
+		FigureType figure(const BB& seed, const BB& rowsH, const BB& rowsV, BB& figure) const
+		{
+			BB figureH = {}, figureV = {};
+			BB seedH = seed & rowsH, seedV = seed & rowsV;
+			while (seedH.any() || seedV.any())
+			{
+				if (seedH.any())
+					figureH |= growH(seedH, rowsH);
+				if (seedV.any())
+					figureV |= growV(seedV, rowsV);
+				figure = figureH | figureV;
+				//crossing cells whose perpendicular row has not been added yet
+				seedH = figure & rowsH & ~figureH;
+				seedV = figure & rowsV & ~figureV;
+			}
+			if (figureH.any() && figureV.any())
+				return FigureType::LT;
+			return figureH.any() ? FigureType::RowH : FigureType::RowV;
+		}
+	};
+
+	template<int W> void writeMatch(KDiamond::BitBoard<W> cells, FigureType type, KDiamond::Match& match)
+	{
+		match.type = type;
+		match.count = 0;
+		while (cells.any())
+			match.cells[match.count++] = cells.takeLowest();
+	}
+
+	inline void setBit(uint64_t* plane, int index)
+	{
+		plane[index >> 6] |= uint64_t(1) << (index & 63);
+	}
+
+	inline void clearBit(uint64_t* plane, int index)
+	{
+		plane[index >> 6] &= ~(uint64_t(1) << (index & 63));
+	}
+}
+
+//END bitboard geometry
+
+//BEGIN Zobrist keys
+
+namespace
+{
+	const int JollyTypeCount = (int) JollyType::Bag + 1;
+
+	//One random key per cell, color and jolly type. The keys are the same in
+	//every run of the program, so that hashes can be stored (e.g. in replays).
+	//Empty cells have the key 0, so that the hash of an empty board only
+	//depends on its size.
+	struct ZobristKeys
+	{
+		uint64_t cells[KDiamond::MaxCellCount][KDiamond::ColorsCount][JollyTypeCount];
+		uint64_t sizes[KDiamond::MaxBoardSize + 1];
+	};
+
+	//SplitMix64 (see http://xorshift.di.unimi.it/splitmix64.c)
+	uint64_t splitMix64(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		return z ^ (z >> 31);
+	}
+
+	bool initZobristKeys(ZobristKeys* keys)
+	{
+		uint64_t state = 0x4b4469616d6f6e64ULL; //"KDiamond"
+		for (int index = 0; index < KDiamond::MaxCellCount; ++index)
+			for (int color = 0; color < KDiamond::ColorsCount; ++color)
+				for (int jolly = 0; jolly < JollyTypeCount; ++jolly)
+					keys->cells[index][color][jolly] = splitMix64(state);
+		for (int index = 0; index < KDiamond::MaxCellCount; ++index)
+			keys->cells[index][KDiamond::Selection][(int) JollyType::None] = 0;
+		for (int size = 0; size <= KDiamond::MaxBoardSize; ++size)
+			keys->sizes[size] = splitMix64(state);
+		return true;
+	}
+
+	const ZobristKeys& zobristKeys()
+	{
+		static ZobristKeys keys;
+		static const bool initialized = initZobristKeys(&keys);
+		(void) initialized;
+		return keys;
+	}
+
+	inline uint64_t cellKey(const ZobristKeys& keys, int index, int color, int jolly)
+	{
+		return keys.cells[index][color][jolly];
+	}
+}
+
+//END Zobrist keys
+
+KDiamond::BoardModel::BoardModel(int size, int colorCount)
+	: m_size(size)
+	, m_colorCount(colorCount)
+	, m_words((size * size + 63) / 64)
+	, m_hash(zobristKeys().sizes[size])
+{
+	std::memset(m_colors, KDiamond::Selection, sizeof(m_colors));
+	std::memset(m_jollies, (int) JollyType::None, sizeof(m_jollies));
+	std::memset(m_planes, 0, sizeof(m_planes));
+	std::memset(m_changed, 0, sizeof(m_changed));
+	//all cells are empty initially
+	std::memcpy(m_planes[KDiamond::Selection], geometry(size).valid, sizeof(m_planes[0]));
+}
+
+void KDiamond::BoardModel::clearChangedCells()
+{
+	std::memset(m_changed, 0, sizeof(m_changed));
+}
+
+void KDiamond::BoardModel::crossNeighborhood(const uint64_t* cells, uint64_t* result) const
+{
+	const Geometry& g = geometry(m_size);
+	switch (m_words)
+	{
+		case 1: {
+			const BitBoard<1> b = FigureKernel<1>(m_size).crossNeighborhood(BitBoard<1>::load(cells), BitBoard<1>::load(g.valid));
+			result[0] |= b.w[0];
+			break;
+		}
+		case 2: {
+			const BitBoard<2> b = FigureKernel<2>(m_size).crossNeighborhood(BitBoard<2>::load(cells), BitBoard<2>::load(g.valid));
+			for (int i = 0; i < 2; ++i)
+				result[i] |= b.w[i];
+			break;
+		}
+		default: {
+			const BitBoard<3> b = FigureKernel<3>(m_size).crossNeighborhood(BitBoard<3>::load(cells), BitBoard<3>::load(g.valid));
+			for (int i = 0; i < 3; ++i)
+				result[i] |= b.w[i];
+			break;
+		}
+	}
+}
+
+uint64_t KDiamond::BoardModel::computeHash() const
+{
+	const ZobristKeys& keys = zobristKeys();
+	uint64_t hash = keys.sizes[m_size];
+	for (int index = 0; index < cellCount(); ++index)
+		hash ^= cellKey(keys, index, m_colors[index], m_jollies[index]);
+	return hash;
+}
+
+void KDiamond::BoardModel::setCell(int index, int color, JollyType jollyType)
+{
+	const ZobristKeys& keys = zobristKeys();
+	m_hash ^= cellKey(keys, index, m_colors[index], m_jollies[index]) ^ cellKey(keys, index, color, (int) jollyType);
+	if (m_colors[index] != color)
+	{
+		clearBit(m_planes[m_colors[index]], index);
+		setBit(m_planes[color], index);
+		setBit(m_changed, index);
+	}
+	m_colors[index] = color;
+	m_jollies[index] = (unsigned char) jollyType;
+}
+
+void KDiamond::BoardModel::removeCell(int index)
+{
+	setCell(index, KDiamond::Selection);
+}
+
+void KDiamond::BoardModel::swapCells(int index1, int index2)
+{
+	const unsigned char color1 = m_colors[index1], color2 = m_colors[index2];
+	if (color1 != color2)
+	{
+		clearBit(m_planes[color1], index1);
+		clearBit(m_planes[color2], index2);
+		setBit(m_planes[color1], index2);
+		setBit(m_planes[color2], index1);
+		setBit(m_changed, index1);
+		setBit(m_changed, index2);
+	}
+	const ZobristKeys& keys = zobristKeys();
+	const unsigned char jolly1 = m_jollies[index1], jolly2 = m_jollies[index2];
+	m_hash ^= cellKey(keys, index1, color1, jolly1) ^ cellKey(keys, index2, color2, jolly2)
+		^ cellKey(keys, index1, color2, jolly2) ^ cellKey(keys, index2, color1, jolly1);
+	const unsigned char jolly = m_jollies[index1];
+	m_colors[index1] = color2;
+	m_jollies[index1] = m_jollies[index2];
+	m_colors[index2] = color1;
+	m_jollies[index2] = jolly;
+}
+
+void KDiamond::BoardModel::collapse(std::vector<Drop>* drops)
+{
+	int x, y, yt; //counters - (x, yt) is the target position of diamond (x,y)
+	for (x = 0; x < m_size; ++x)
+	{
+		//We have to search from the bottom of the column. Exclude the lowest element (y = m_size - 1) because it cannot move down.
+		for (y = m_size - 2; y >= 0; --y)
+		{
+			if (isEmpty(index(x, y)))
+				//no need to move gaps -> these are moved later
+				continue;
+			if (!isEmpty(index(x, y + 1)))
+				//there is something right below this diamond -> Do not move.
+				continue;
+			//search for the lowest possible position
+			for (yt = y; yt < m_size - 1; ++yt)
+			{
+				if (!isEmpty(index(x, yt + 1)))
+					break; //yt now holds the lowest possible position
+			}
+			swapCells(index(x, y), index(x, yt));
+			if (drops)
+			{
+				const Drop drop = { x, y, yt };
+				drops->push_back(drop);
+			}
+		}
+	}
+}
+
+template<int W> bool KDiamond::BoardModel::findFigureImpl(int index, int color, int vacated, Match& match) const
+{
+	typedef KDiamond::BitBoard<W> BB;
+	const FigureKernel<W> kernel(m_size);
+	const BB seed = BB::single(index);
+	BB plane = BB::load(m_planes[color]) | seed;
+	if (vacated >= 0)
+		plane &= ~BB::single(vacated);
+	const BB rowsH = kernel.rowsH(plane), rowsV = kernel.rowsV(plane);
+	if (!((rowsH | rowsV) & seed).any())
+		return false;
+	BB cells = {};
+	const FigureType type = kernel.figure(seed, rowsH, rowsV, cells);
+	writeMatch(cells, type, match);
+	return true;
+}
+
+template<int W> int KDiamond::BoardModel::findFiguresImpl(std::vector<Match>& figures) const
+{
+	typedef KDiamond::BitBoard<W> BB;
+	const FigureKernel<W> kernel(m_size);
+	Match match;
+	int result = 0;
+	for (int color = 1; color <= m_colorCount; ++color)
+	{
+		const BB plane = BB::load(m_planes[color]);
+		const BB rowsH = kernel.rowsH(plane), rowsV = kernel.rowsV(plane);
+		BB remaining = rowsH | rowsV;
+		while (remaining.any())
+		{
+			BB cells = {};
+			const FigureType type = kernel.figure(BB::single(remaining.lowest()), rowsH, rowsV, cells);
+			remaining &= ~cells;
+			writeMatch(cells, type, match);
+			figures.push_back(match);
+			++result;
+		}
+	}
+	return result;
+}
+
+bool KDiamond::BoardModel::findFigure(int index, Match& figure) const
+{
+	figure.type = FigureType::None;
+	figure.count = 0;
+	if (isEmpty(index))
+		return false;
+	switch (m_words)
+	{
+		case 1: return findFigureImpl<1>(index, m_colors[index], -1, figure);
+		case 2: return findFigureImpl<2>(index, m_colors[index], -1, figure);
+		default: return findFigureImpl<3>(index, m_colors[index], -1, figure);
+	}
+}
+
+bool KDiamond::BoardModel::matchesPattern(int from, int to) const
+{
+	const int x0 = x(from), y0 = y(from);
+	const SwapPattern* patterns = (to == from + 1) ? RightSwapPatterns : DownSwapPatterns;
+	for (int i = 0; i < SwapPatternCount; ++i)
+	{
+		const SwapPattern& p = patterns[i];
+		const int x1 = x0 + p.dx1, y1 = y0 + p.dy1, x2 = x0 + p.dx2, y2 = y0 + p.dy2;
+		if (!contains(x1, y1) || !contains(x2, y2))
+			continue;
+		const int color = m_colors[index(x0 + p.moverDx, y0 + p.moverDy)];
+		if (m_colors[index(x1, y1)] == color && m_colors[index(x2, y2)] == color)
+			return true;
+	}
+	return false;
+}
+
+bool KDiamond::BoardModel::evaluateSwap(int from, int to, Swap& swap) const
+{
+	swap.from = from;
+	swap.to = to;
+	swap.figure1.type = swap.figure2.type = FigureType::None;
+	swap.figure1.count = swap.figure2.count = 0;
+	//swapping equal colors does not change anything
+	const int color1 = m_colors[from], color2 = m_colors[to];
+	if (color1 == color2 || color1 == KDiamond::Selection || color2 == KDiamond::Selection)
+		return false;
+	//cheap check on the local neighborhood first, most swaps are rejected here
+	if (!matchesPattern(from, to))
+		return false;
+	//collect the figures on the bitboards as they would look after the swap
+	switch (m_words)
+	{
+		case 1:
+			findFigureImpl<1>(from, color2, to, swap.figure1);
+			findFigureImpl<1>(to, color1, from, swap.figure2);
+			break;
+		case 2:
+			findFigureImpl<2>(from, color2, to, swap.figure1);
+			findFigureImpl<2>(to, color1, from, swap.figure2);
+			break;
+		default:
+			findFigureImpl<3>(from, color2, to, swap.figure1);
+			findFigureImpl<3>(to, color1, from, swap.figure2);
+			break;
+	}
+	return true;
+}
+
+int KDiamond::BoardModel::findFigures(std::vector<Match>& figures) const
+{
+	switch (m_words)
+	{
+		case 1: return findFiguresImpl<1>(figures);
+		case 2: return findFiguresImpl<2>(figures);
+		default: return findFiguresImpl<3>(figures);
+	}
+}
+
+int KDiamond::BoardModel::findSwaps(std::vector<Swap>& swaps) const
+{
+	Swap swap;
+	int result = 0;
+	for (int x = 0; x < m_size; ++x)
+		for (int y = 0; y < m_size; ++y)
+		{
+			//only look to the right and downwards, the other directions are
+			//covered by the other cells
+			if (x + 1 < m_size && evaluateSwap(index(x, y), index(x + 1, y), swap))
+			{
+				swaps.push_back(swap);
+				++result;
+			}
+			if (y + 1 < m_size && evaluateSwap(index(x, y), index(x, y + 1), swap))
+			{
+				swaps.push_back(swap);
+				++result;
+			}
+		}
+	return result;
+}
+
+#ifdef UNITTEST
+#include <gtest/gtest.h>
+
+//small deterministic generator with the unifInt() interface of rng.h
+struct TestRNG{
+    unsigned int state;
+    TestRNG(unsigned int seed) : state(seed) {}
+    int unifInt(int n){
+        state = state * 1103515245u + 12345u;
+        return (state >> 16) % n;
+    }
+};
+
+TEST(BoardModel, generateHasNoFigures){
+    TestRNG rng(17);
+    for(int difficulty = 0; difficulty < KDiamond::DifficultyCount; ++difficulty){
+        KDiamond::BoardModel board(KDiamond::boardSize(difficulty), KDiamond::boardColorCount(difficulty));
+        board.generate(rng);
+        std::vector<KDiamond::Match> figures;
+        EXPECT_EQ(0, board.findFigures(figures));
+    }
+}
+
+TEST(BoardModel, collapseAndRefill){
+    TestRNG rng(17);
+    KDiamond::BoardModel board;
+    board.generate(rng);
+    const int above = board.color(board.index(3, 6));
+    board.removeCell(board.index(3, 7));
+    std::vector<KDiamond::Drop> drops;
+    board.collapse(&drops);
+    EXPECT_EQ(above, board.color(board.index(3, 7)));
+    EXPECT_TRUE(board.isEmpty(board.index(3, 0)));
+    EXPECT_EQ(7, (int) drops.size());
+    drops.clear();
+    board.refill(rng, &drops);
+    EXPECT_EQ(1, (int) drops.size());
+    EXPECT_EQ(-1, drops[0].fromY);
+    EXPECT_FALSE(board.isEmpty(board.index(3, 0)));
+}
+
+TEST(BoardModel, findFigureLT){
+    KDiamond::BoardModel board(8, 5);
+    for(int i = 0; i < board.cellCount(); ++i){
+        board.setCell(i, 1 + (board.x(i) + 2 * board.y(i)) % 5);
+    }
+    //L shape of color 5 in the upper left corner
+    board.setCell(board.index(0, 0), 5);
+    board.setCell(board.index(1, 0), 5);
+    board.setCell(board.index(2, 0), 5);
+    board.setCell(board.index(0, 1), 5);
+    board.setCell(board.index(0, 2), 5);
+    KDiamond::Match figure;
+    EXPECT_TRUE(board.findFigure(board.index(2, 0), figure));
+    EXPECT_EQ(FigureType::LT, figure.type);
+    EXPECT_EQ(5, figure.count);
+    std::vector<KDiamond::Match> figures;
+    EXPECT_EQ(1, board.findFigures(figures));
+}
+TEST(BoardModel, findFiguresAcrossWords){
+    //on 12x12 boards, the bitboards consist of three words
+    KDiamond::BoardModel board(12, 5);
+    for(int i = 0; i < board.cellCount(); ++i){
+        board.setCell(i, 1 + (board.x(i) + 2 * board.y(i)) % 4);
+    }
+    //horizontal row with cells 62, 63, 64 (x = 2..4, y = 5)
+    for(int x = 2; x <= 4; ++x){
+        board.setCell(board.index(x, 5), 5);
+    }
+    //vertical row at x = 9, y = 4..6 (cells 57, 69, 81)
+    for(int y = 4; y <= 6; ++y){
+        board.setCell(board.index(9, y), 5);
+    }
+    std::vector<KDiamond::Match> figures;
+    EXPECT_EQ(2, board.findFigures(figures));
+    //figures are ordered by their first cell
+    EXPECT_EQ(FigureType::RowV, figures[0].type);
+    EXPECT_EQ(FigureType::RowH, figures[1].type);
+    EXPECT_EQ(3, figures[0].count);
+    EXPECT_EQ(3, figures[1].count);
+    //the row must not wrap around into the next row
+    board.setCell(board.index(11, 4), 5);
+    board.setCell(board.index(0, 5), 5);
+    figures.clear();
+    EXPECT_EQ(2, board.findFigures(figures));
+}
+
+TEST(BoardModel, incrementalHash){
+    TestRNG rng(23);
+    KDiamond::BoardModel board(10, 5);
+    const uint64_t emptyHash = board.hash();
+    EXPECT_EQ(board.computeHash(), emptyHash);
+    board.generate(rng);
+    EXPECT_NE(emptyHash, board.hash());
+    EXPECT_EQ(board.computeHash(), board.hash());
+    //swapping twice restores the position
+    const uint64_t generated = board.hash();
+    board.swapCells(board.index(2, 3), board.index(3, 3));
+    EXPECT_NE(generated, board.hash());
+    board.swapCells(board.index(2, 3), board.index(3, 3));
+    EXPECT_EQ(generated, board.hash());
+    //jollies are part of the position
+    board.setCell(board.index(4, 4), board.color(board.index(4, 4)), JollyType::H);
+    EXPECT_NE(generated, board.hash());
+    for(int i = 0; i < 20; ++i){
+        board.removeCell(rng.unifInt(board.cellCount()));
+        board.swapCells(board.index(0, 9), board.index(0, 8));
+        board.collapse();
+        board.refill(rng);
+        EXPECT_EQ(board.computeHash(), board.hash());
+    }
+    //equal positions have equal hashes regardless of their history
+    KDiamond::BoardModel copy(10, 5);
+    for(int i = 0; i < board.cellCount(); ++i){
+        copy.setCell(i, board.color(i), board.jollyType(i));
+    }
+    EXPECT_EQ(board.hash(), copy.hash());
+}
+#endif //UNITTEST
@@ -0,0 +1,211 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_BOARDMODEL_H
+#define KDIAMOND_BOARDMODEL_H
+
+#include <stdint.h>
+#include <vector>
+
+//NOTE: This header must not depend on Qt. The board model is shared between
+//the GUI (which mirrors it with Diamond items) and headless tools.
+
+namespace KDiamond
+{
+	//registered colors of diamonds
+	enum Color
+	{
+		NoColor = -1,  //use this if no actual color can be named (e.g. for a null Diamond pointer)
+		Selection = 0, //actually no diamond type, but this allows to reuse the Diamond class' code for the selection marker
+		RedDiamond = 1,
+		GreenDiamond,
+		BlueDiamond,
+		YellowDiamond,
+		WhiteDiamond,
+		BlackDiamond,
+		OrangeDiamond,
+		ColorsCount
+	};
+
+	//base duration of a game in seconds
+	const int GameDuration = 200;
+
+	//number of difficulty levels (see KgDifficultyLevel::VeryEasy to KgDifficultyLevel::VeryHard)
+	const int DifficultyCount = 5;
+	int boardSize(int difficultyIndex);
+	int boardColorCount(int difficultyIndex);
+}
+
+enum class JollyType {None = 0, H, V, Cookie, Bag};
+
+enum class FigureType {
+    None,
+    RowH = 1,
+    RowV,
+    LT
+};
+
+namespace KDiamond
+{
+	const int MaxBoardSize = 12;
+	const int MaxCellCount = MaxBoardSize * MaxBoardSize;
+	const int PlaneWords = (MaxCellCount + 63) / 64;
+
+	//A figure found on the board. Cells are given as indices into the board model.
+	struct Match
+	{
+		FigureType type;
+		int count;
+		unsigned char cells[MaxCellCount];
+	};
+
+	//A legal swap together with the figures it would form.
+	struct Swap
+	{
+		int from, to;
+		Match figure1, figure2;
+
+		int numToDelete() const { return figure1.count + figure2.count; }
+	};
+
+	//A diamond moving down a column during KDiamond::BoardModel::collapse()
+	//or refill(). Diamonds spawned by refill() have a negative fromY.
+	struct Drop
+	{
+		int x, fromY, toY;
+	};
+
+	//Plain value-type representation of the board: one color byte and one
+	//jolly byte per cell, plus the rules of the game (figure detection,
+	//gravity and refill). Empty cells have color KDiamond::Selection.
+	//Additionally, one bitboard per color is kept in sync with the color bytes
+	//(see bitboard.h), on which figures are detected with shift-and-AND.
+	class BoardModel
+	{
+		public:
+			BoardModel(int size = 8, int colorCount = 5);
+
+			int size() const { return m_size; }
+			int colorCount() const { return m_colorCount; }
+			int cellCount() const { return m_size * m_size; }
+			int index(int x, int y) const { return x + y * m_size; }
+			int x(int index) const { return index % m_size; }
+			int y(int index) const { return index / m_size; }
+			bool contains(int x, int y) const { return 0 <= x && x < m_size && 0 <= y && y < m_size; }
+
+			int color(int index) const { return m_colors[index]; }
+			JollyType jollyType(int index) const { return (JollyType) m_jollies[index]; }
+			bool isEmpty(int index) const { return m_colors[index] == KDiamond::Selection; }
+			//Zobrist hash of the position, i.e. of the size and of the color and
+			//jolly type of each cell. It is updated with every changed cell, and
+			//it is the same in every run of the program.
+			uint64_t hash() const { return m_hash; }
+			//recomputes hash() from scratch (for consistency checks)
+			uint64_t computeHash() const;
+			//bitboard of the cells with the given color (KDiamond::Selection gives the empty cells)
+			const uint64_t* plane(int color) const { return m_planes[color]; }
+			//number of 64-bit words used by the bitboards of this board
+			int planeWords() const { return m_words; }
+			//bitboard of the cells whose color has changed since the last clearChangedCells()
+			const uint64_t* changedCells() const { return m_changed; }
+			void clearChangedCells();
+			//Adds all cells to result (a bitboard) that are at most two cells
+			//away from one of the given cells along a row or column.
+			void crossNeighborhood(const uint64_t* cells, uint64_t* result) const;
+
+			void setCell(int index, int color, JollyType jollyType = JollyType::None);
+			void removeCell(int index);
+			void swapCells(int index1, int index2);
+
+			//Fills the whole board with random colors, such that no figures are
+			//present from the start. RNG needs to provide unifInt(n) (see rng.h).
+			template<class RNG> void generate(RNG& rng);
+			//Moves diamonds down into empty cells below them.
+			void collapse(std::vector<Drop>* drops = 0);
+			//Fills the empty cells (which must be at the top of each column after
+			//collapse()) with random colors.
+			template<class RNG> void refill(RNG& rng, std::vector<Drop>* drops = 0);
+
+			//Returns the number of figures found, which are appended to figures.
+			int findFigures(std::vector<Match>& figures) const;
+			//Returns false if the diamond at index is not part of a figure.
+			bool findFigure(int index, Match& figure) const;
+			//Returns whether swapping the cells from and to (to must be the right or
+			//lower neighbor of from) forms a figure, and fills swap with the figures.
+			//The board is not modified during the evaluation.
+			bool evaluateSwap(int from, int to, Swap& swap) const;
+			//Returns the number of legal swaps, which are appended to swaps.
+			int findSwaps(std::vector<Swap>& swaps) const;
+		private:
+			template<int W> int findFiguresImpl(std::vector<Match>& figures) const;
+			//figure at index if it had the given color and the vacated cell (if any) had a different one
+			template<int W> bool findFigureImpl(int index, int color, int vacated, Match& figure) const;
+			bool matchesPattern(int from, int to) const;
+
+			int m_size, m_colorCount, m_words;
+			uint64_t m_hash;
+			unsigned char m_colors[MaxCellCount];
+			unsigned char m_jollies[MaxCellCount];
+			uint64_t m_planes[ColorsCount][PlaneWords];
+			uint64_t m_changed[PlaneWords];
+	};
+}
+
+template<class RNG> void KDiamond::BoardModel::generate(RNG& rng)
+{
+	for (int x = 0; x < m_size; ++x)
+		for (int y = 0; y < m_size; ++y)
+		{
+			//roll the dice to get a color, but ensure that there are not three of a color in a row from the start
+			int color;
+			while (true)
+			{
+				color = rng.unifInt(m_colorCount) + 1; // +1 because numbering of enum KDiamond::Color starts at 1
+				//condition: no triplet in y axis (attention: only the diamonds above us are defined already)
+				if (y >= 2 && m_colors[index(x, y - 1)] == color && m_colors[index(x, y - 2)] == color)
+					continue; //roll the dice again
+				//same condition on x axis
+				if (x >= 2 && m_colors[index(x - 1, y)] == color && m_colors[index(x - 2, y)] == color)
+					continue;
+				break;
+			}
+			setCell(index(x, y), color);
+		}
+}
+
+template<class RNG> void KDiamond::BoardModel::refill(RNG& rng, std::vector<Drop>* drops)
+{
+	for (int x = 0; x < m_size; ++x)
+	{
+		int yt = 0; //holds the position from where the diamond comes (-1 for the lowest new diamond)
+		for (int y = m_size - 1; y >= 0; --y)
+		{
+			if (!isEmpty(index(x, y)))
+				continue; //inside of diamond stack - no gaps to fill
+			--yt;
+			setCell(index(x, y), rng.unifInt(m_colorCount) + 1);
+			if (drops)
+			{
+				const Drop drop = { x, yt, y };
+				drops->push_back(drop);
+			}
+		}
+	}
+}
+
+#endif // KDIAMOND_BOARDMODEL_H
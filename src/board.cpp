@@ -17,80 +17,71 @@
  ***************************************************************************/
 
 #include "board.h"
+#include "board-animator.h"
 #include "diamond.h"
+#include "move-index.h"
+#include "rng.h"
 
-#include <QPropertyAnimation>
 #include <KgDifficulty>
 
 const int KDiamond::Board::MoveDuration = 100; //duration of a move animation (per coordinate unit) in milliseconds
 const int KDiamond::Board::RemoveDuration = 200; //duration of a move animation in milliseconds
 
-//NOTE: The corresponding difficulty values are {20, 30, 40, 50, 60} (see KgDifficultyLevel::StandardLevel).
-static int boardSizes[] = { 12, 10, 8, 8, 8 };
-static int boardColorCounts[] = { 5, 5, 5, 6, 7 };
-
-KDiamond::Board::Board(KGameRenderer* renderer)
+KDiamond::Board::Board(KGameRenderer* renderer, cpputils::RandomSource& rng)
 	: m_difficultyIndex(Kg::difficultyLevel() / 10 - 2)
-	, m_size(boardSizes[m_difficultyIndex])
-	, m_colorCount(boardColorCounts[m_difficultyIndex])
+	, m_size(KDiamond::boardSize(m_difficultyIndex))
+	, m_model(m_size, KDiamond::boardColorCount(m_difficultyIndex))
+	, m_rng(rng)
 	, m_paused(false)
+	, m_animated(true)
 	, m_renderer(renderer)
 	, m_diamonds(m_size * m_size, 0)
+	, m_animator(new KDiamond::BoardAnimator(this))
 {
+	connect(m_animator, SIGNAL(finished()), SLOT(slotAnimationFinished()));
+	m_model.generate(m_rng);
 	for (QPoint point; point.x() < m_size; ++point.rx())
 		for (point.ry() = 0; point.y() < m_size; ++point.ry())
 		{
-			//displacement vectors needed for the following algorithm
-			const QPoint dispY1(0, -1), dispY2(0, -2);
-			const QPoint dispX1(-1, 0), dispX2(-2, 0);
-			//roll the dice to get a color, but ensure that there are not three of a color in a row from the start
-			int color;
-			while (true)
-			{
-				color = qrand() % m_colorCount + 1; // +1 because numbering of enum KDiamond::Color starts at 1
-				//condition: no triplet in y axis (attention: only the diamonds above us are defined already)
-				if (point.y() >= 2) //no triplet possible for i = 0, 1
-				{
-					const int otherColor1 = diamond(point + dispY1)->color();
-					const int otherColor2 = diamond(point + dispY2)->color();
-					if (otherColor1 == color && otherColor2 == color)
-						continue; //roll the dice again
-				}
-				//same condition on x axis
-				if (point.x() >= 2)
-				{
-					const int otherColor1 = diamond(point + dispX1)->color();
-					const int otherColor2 = diamond(point + dispX2)->color();
-					if (otherColor1 == color && otherColor2 == color)
-						continue;
-				}
-				break;
-			}
-			rDiamond(point) = spawnDiamond(color);
+			const int index = m_model.index(point.x(), point.y());
+			setDiamond(point, spawnDiamond(m_model.color(index), m_model.jollyType(index)));
 			diamond(point)->setPos(point);
 		}
 }
 
-Diamond* KDiamond::Board::spawnDiamond(int color)
+Diamond* KDiamond::Board::spawnDiamond(int color, JollyType jollyType)
 {
-	Diamond* diamond = new Diamond((KDiamond::Color) color, m_renderer, this);
+	//reuse a removed diamond if possible (like the selection markers)
+	if (!m_inactiveDiamonds.isEmpty())
+	{
+		Diamond* diamond = m_inactiveDiamonds.takeLast();
+		diamond->reset((KDiamond::Color) color, jollyType);
+		diamond->show();
+		return diamond;
+	}
+	Diamond* diamond = new Diamond((KDiamond::Color) color, m_renderer, this, jollyType);
 	connect(diamond, SIGNAL(clicked()), SLOT(slotClicked()));
 	connect(diamond, SIGNAL(dragged(QPoint)), SLOT(slotDragged(QPoint)));
 	return diamond;
 }
 
+void KDiamond::Board::recycleDiamond(Diamond* diamond)
+{
+	diamond->hide();
+	m_inactiveDiamonds << diamond;
+}
+
 QPoint KDiamond::Board::findDiamond(Diamond* diamond) const
 {
-	int index = m_diamonds.indexOf(diamond);
-	if (index == -1)
-		return QPoint(-1, -1);
-	else
-		return QPoint(index % m_size, index / m_size);
+	//the diamond knows its cell, so that mouse events do not need to search the grid
+	return diamond ? diamond->gridPosition() : QPoint(-1, -1);
 }
 
-Diamond*& KDiamond::Board::rDiamond(const QPoint& point)
+void KDiamond::Board::setDiamond(const QPoint& point, Diamond* diamond)
 {
-	return m_diamonds[point.x() + point.y() * m_size];
+	m_diamonds[point.x() + point.y() * m_size] = diamond;
+	if (diamond)
+		diamond->setGridPosition(point);
 }
 
 Diamond* KDiamond::Board::diamond(const QPoint& point) const
@@ -98,6 +89,16 @@ Diamond* KDiamond::Board::diamond(const QPoint& point) const
 	return m_diamonds.value(point.x() + point.y() * m_size);
 }
 
+const KDiamond::BoardModel& KDiamond::Board::model() const
+{
+	return m_model;
+}
+
+void KDiamond::Board::updateMoves(KDiamond::MoveIndex& moves)
+{
+	moves.update(m_model);
+}
+
 int KDiamond::Board::gridSize() const
 {
 	return m_size;
@@ -110,18 +111,16 @@ bool KDiamond::Board::hasDiamond(const QPoint& point) const
 
 bool KDiamond::Board::hasRunningAnimations() const
 {
-	return !m_runningAnimations.isEmpty();
+	return m_animator->isActive();
 }
 
 void KDiamond::Board::slotAnimationFinished()
 {
-	if (m_runningAnimations.isEmpty())
-		return;
-	//static_cast is enough, no need for a qobject_cast
-	//because result pointer is never dereferenced here
-	m_runningAnimations.removeAll(static_cast<QAbstractAnimation*>(sender()));
-	if (m_runningAnimations.isEmpty())
-		emit animationsFinished();
+	//keep the removed diamonds for reuse instead of deleting them
+	foreach (Diamond* diamond, m_animator->removedDiamonds())
+		recycleDiamond(diamond);
+	m_animator->clear();
+	emit animationsFinished();
 }
 
 QList<QPoint> KDiamond::Board::selections() const
@@ -181,9 +180,8 @@ void KDiamond::Board::setPaused(bool paused)
 	if (isVisible() == visible)
 		return;
 	setVisible(visible);
-	QList<QAbstractAnimation*>::const_iterator it1 = m_runningAnimations.constBegin(), it2 = m_runningAnimations.constEnd();
-	for (; it1 != it2; ++it1)
-		(*it1)->setPaused(paused);
+	if (m_animator->state() != QAbstractAnimation::Stopped)
+		m_animator->setPaused(paused);
 }
 
 void KDiamond::Board::removeDiamond(const QPoint& point)
@@ -191,30 +189,36 @@ void KDiamond::Board::removeDiamond(const QPoint& point)
 	Diamond* diamond = this->diamond(point);
 	if (!diamond)
 		return; //diamond has already been removed
-	rDiamond(point) = 0;
+	setDiamond(point, 0);
+	diamond->setGridPosition(QPoint(-1, -1));
+	m_model.removeCell(m_model.index(point.x(), point.y()));
+	if (!m_animated)
+	{
+		recycleDiamond(diamond);
+		return;
+	}
 	//play remove animation (TODO: For non-animated sprites, play an opacity animation instead.)
-	QPropertyAnimation* animation = new QPropertyAnimation(diamond, "frame", this);
-	animation->setStartValue(0);
-	animation->setEndValue(diamond->frameCount() - 1);
-	animation->setDuration(KDiamond::Board::RemoveDuration);
-	animation->start(QAbstractAnimation::DeleteWhenStopped);
-	connect(animation, SIGNAL(finished()), this, SLOT(slotAnimationFinished()));
-	connect(animation, SIGNAL(finished()), diamond, SLOT(deleteLater()));
-	m_runningAnimations << animation;
+	m_animator->addRemoval(diamond, KDiamond::Board::RemoveDuration);
+}
+
+void KDiamond::Board::setAnimated(bool animated)
+{
+	m_animated = animated;
 }
 
 void KDiamond::Board::spawnMoveAnimations(const QList<MoveAnimSpec>& specs)
 {
+	if (!m_animated)
+	{
+		//only snap the items to their new positions
+		foreach (const MoveAnimSpec& spec, specs)
+			spec.diamond->setPos(spec.to);
+		return;
+	}
 	foreach (const MoveAnimSpec& spec, specs)
 	{
 		const int duration = KDiamond::Board::MoveDuration * (spec.to - spec.from).manhattanLength();
-		QPropertyAnimation* animation = new QPropertyAnimation(spec.diamond, "pos", this);
-		animation->setStartValue(spec.from);
-		animation->setEndValue(spec.to);
-		animation->setDuration(duration);
-		animation->start(QAbstractAnimation::DeleteWhenStopped);
-		connect(animation, SIGNAL(finished()), this, SLOT(slotAnimationFinished()));
-		m_runningAnimations << animation;
+		m_animator->addMove(spec.diamond, spec.from, spec.to, duration);
 	}
 }
 
@@ -223,8 +227,9 @@ void KDiamond::Board::swapDiamonds(const QPoint& point1, const QPoint& point2, b
 	//swap diamonds in internal representation
 	Diamond* diamond1 = this->diamond(point1);
 	Diamond* diamond2 = this->diamond(point2);
-	rDiamond(point1) = diamond2;
-	rDiamond(point2) = diamond1;
+	setDiamond(point1, diamond2);
+	setDiamond(point2, diamond1);
+	m_model.swapCells(m_model.index(point1.x(), point1.y()), m_model.index(point2.x(), point2.y()));
 	//play movement animations
 	if(animated){
         const MoveAnimSpec spec1 = { diamond1, point1, point2 };
@@ -236,54 +241,37 @@ void KDiamond::Board::swapDiamonds(const QPoint& point1, const QPoint& point2, b
 void KDiamond::Board::fillGaps()
 {
 	QList<MoveAnimSpec> specs;
-	//fill gaps
-	int x, y, yt; //counters - (x, yt) is the target position of diamond (x,y)
-	for (x = 0; x < m_size; ++x)
+	//fill gaps (the model reports each movement, which is then applied to the diamond items)
+	std::vector<KDiamond::Drop> drops;
+	m_model.collapse(&drops);
+	foreach (const KDiamond::Drop& drop, drops)
 	{
-		//We have to search from the bottom of the column. Exclude the lowest element (x = m_size - 1) because it cannot move down.
-		for (y = m_size - 2; y >= 0; --y)
+		const QPoint from(drop.x, drop.fromY), to(drop.x, drop.toY);
+		setDiamond(to, diamond(from));
+		setDiamond(from, 0);
+		const MoveAnimSpec spec = { diamond(to), from, to };
+		specs << spec;
+		//if this element is selected, move the selection, too
+		const int index = m_selections.indexOf(from);
+		if (index != -1)
 		{
-			if (!diamond(QPoint(x, y)))
-				//no need to move gaps -> these are moved later
-				continue;
-			if (diamond(QPoint(x, y + 1)))
-				//there is something right below this diamond -> Do not move.
-				continue;
-			//search for the lowest possible position
-			for (yt = y; yt < m_size - 1; ++yt)
-			{
-				if (diamond(QPoint(x, yt + 1)))
-					break; //xt now holds the lowest possible position
-			}
-			rDiamond(QPoint(x, yt)) = diamond(QPoint(x, y));
-			rDiamond(QPoint(x, y)) = 0;
-			const MoveAnimSpec spec = { diamond(QPoint(x, yt)), QPoint(x, y), QPoint(x, yt) };
+			m_selections.replace(index, to);
+			const MoveAnimSpec spec = { m_activeSelectors[index], from, to };
 			specs << spec;
-			//if this element is selected, move the selection, too
-			const int index = m_selections.indexOf(QPoint(x, y));
-			if (index != -1)
-			{
-				m_selections.replace(index, QPoint(x, yt));
-				const MoveAnimSpec spec = { m_activeSelectors[index], QPoint(x, y), QPoint(x, yt) };
-				specs << spec;
-			}
 		}
 	}
 	//fill top rows with new elements
-	for (x = 0; x < m_size; ++x)
+	drops.clear();
+	m_model.refill(m_rng, &drops);
+	foreach (const KDiamond::Drop& drop, drops)
 	{
-		yt = 0; //now: holds the position from where the diamond comes (-1 for the lowest new diamond)
-		for (y = m_size - 1; y >= 0; --y)
-		{
-			Diamond*& diamond = this->rDiamond(QPoint(x, y));
-			if (diamond)
-				continue; //inside of diamond stack - no gaps to fill
-			--yt;
-			diamond = spawnDiamond(qrand() % m_colorCount + 1);
-			diamond->setPos(QPoint(x, yt));
-			const MoveAnimSpec spec = { diamond, QPoint(x, yt), QPoint(x, y) };
-			specs << spec;
-		}
+		const QPoint from(drop.x, drop.fromY), to(drop.x, drop.toY);
+		const int index = m_model.index(to.x(), to.y());
+		Diamond* diamond = spawnDiamond(m_model.color(index), m_model.jollyType(index));
+		setDiamond(to, diamond);
+		diamond->setPos(from);
+		const MoveAnimSpec spec = { diamond, from, to };
+		specs << spec;
 	}
 	spawnMoveAnimations(specs);
 }
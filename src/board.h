@@ -19,22 +19,34 @@
 #ifndef KDIAMOND_BOARD_H
 #define KDIAMOND_BOARD_H
 
+#include "board-model.h"
+
 class Diamond;
 
-class QAbstractAnimation;
 #include <QGraphicsItem>
 class KGameRenderer;
+namespace cpputils
+{
+	class RandomSource;
+}
 
 namespace KDiamond
 {
+	class BoardAnimator;
+	class MoveIndex;
+
 	class Board : public QGraphicsObject
 	{
 		Q_OBJECT
 		public:
-			Board(KGameRenderer* renderer);
+			//all random draws (initial board and refills) are taken from rng
+			Board(KGameRenderer* renderer, cpputils::RandomSource& rng);
 
 			int gridSize() const;
 			Diamond* diamond(const QPoint& point) const;
+			const KDiamond::BoardModel& model() const;
+			//re-evaluates the moves affected by changes since the last call
+			void updateMoves(KDiamond::MoveIndex& moves);
 
 			bool hasDiamond(const QPoint& point) const;
 			bool hasRunningAnimations() const;
@@ -46,6 +58,9 @@ namespace KDiamond
 			void removeDiamond(const QPoint& point);
 			void swapDiamonds(const QPoint& point1, const QPoint& point2, bool anumated = true);
 			void fillGaps();
+			//If false, diamonds are moved and removed immediately instead of being
+			//animated, such that hasRunningAnimations() stays false.
+			void setAnimated(bool animated);
 
 			virtual QRectF boundingRect() const;
 			virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = 0);
@@ -65,21 +80,26 @@ namespace KDiamond
 				QPointF from, to;
 			};
 			QPoint findDiamond(Diamond* diamond) const;
-			Diamond*& rDiamond(const QPoint& point);
-			Diamond* spawnDiamond(int color);
+			//puts the diamond (which may be null) into the given cell and updates its grid position
+			void setDiamond(const QPoint& point, Diamond* diamond);
+			Diamond* spawnDiamond(int color, JollyType jollyType = JollyType::None);
+			void recycleDiamond(Diamond* diamond);
 			void spawnMoveAnimations(const QList<MoveAnimSpec>& specs);
 
 			static const int MoveDuration;
 			static const int RemoveDuration;
 
-			int m_difficultyIndex, m_size, m_colorCount;
+			int m_difficultyIndex, m_size;
+			KDiamond::BoardModel m_model;
+			cpputils::RandomSource& m_rng;
 			QList<QPoint> m_selections;
-			bool m_paused;
+			bool m_paused, m_animated;
 
 			KGameRenderer* m_renderer;
 			QVector<Diamond*> m_diamonds;
 			QList<Diamond*> m_activeSelectors, m_inactiveSelectors;
-			QList<QAbstractAnimation*> m_runningAnimations;
+			QList<Diamond*> m_inactiveDiamonds; //removed diamonds which can be reused by spawnDiamond()
+			KDiamond::BoardAnimator* m_animator;
 	};
 }
 
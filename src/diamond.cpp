@@ -38,6 +38,8 @@ QString colorKey(KDiamond::Color color)
 Diamond::Diamond(KDiamond::Color color, KGameRenderer* renderer, QGraphicsItem* parent, JollyType jollyType)
 	: KGameRenderedObjectItem(renderer, colorKey(color), parent)
 	, m_color(color)
+	, m_mouseDown(false)
+	, m_gridPosition(-1, -1)
 	, m_jollyType(jollyType)
 {
 	//selection markers do not react to mouse events; they should also appear behind diamonds
@@ -55,6 +57,28 @@ KDiamond::Color Diamond::color() const
 	return m_color;
 }
 
+QPoint Diamond::gridPosition() const
+{
+	return m_gridPosition;
+}
+
+void Diamond::setGridPosition(const QPoint& point)
+{
+	m_gridPosition = point;
+}
+
+void Diamond::reset(KDiamond::Color color, JollyType jollyType)
+{
+	if (m_color != color)
+	{
+		m_color = color;
+		setSpriteKey(colorKey(color));
+	}
+	m_jollyType = jollyType;
+	m_mouseDown = false;
+	setFrame(0);
+}
+
 void Diamond::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
 	m_mouseDown = true;
@@ -19,29 +19,12 @@
 #ifndef KDIAMOND_DIAMOND_H
 #define KDIAMOND_DIAMOND_H
 
-#include <KGameRenderedObjectItem>
-
-namespace KDiamond
-{
-	//registered colors of diamonds
-	enum Color
-	{
-		NoColor = -1,  //use this if no actual color can be named (e.g. for a null Diamond pointer)
-		Selection = 0, //actually no diamond type, but this allows to reuse the Diamond class' code for the selection marker
-		RedDiamond = 1,
-		GreenDiamond,
-		BlueDiamond,
-		YellowDiamond,
-		WhiteDiamond,
-		BlackDiamond,
-		OrangeDiamond,
-		ColorsCount
-	};
-}
+#include "board-model.h"
 
+#include <KGameRenderedObjectItem>
 
-enum class JollyType {None = 0, H, V, Cookie, Bag};
-
+//sprite key of the diamonds with the given color
+QString colorKey(KDiamond::Color color);
 
 class Diamond : public KGameRenderedObjectItem
 {
@@ -50,6 +33,11 @@ class Diamond : public KGameRenderedObjectItem
 		Diamond(KDiamond::Color color, KGameRenderer* renderer, QGraphicsItem* parent = 0, JollyType jollyType = JollyType::None);
 
 		KDiamond::Color color() const;
+		//cell of the board which holds this diamond, or (-1,-1) if it is not on the board
+		QPoint gridPosition() const;
+		void setGridPosition(const QPoint& point);
+		//prepares a recycled diamond for reuse with the given color (see KDiamond::Board::spawnDiamond)
+		void reset(KDiamond::Color color, JollyType jollyType = JollyType::None);
         bool isJolly() const;
         void setJolly(JollyType type);
         JollyType jollyType() const;
@@ -64,6 +52,7 @@ class Diamond : public KGameRenderedObjectItem
 		KDiamond::Color m_color;
 		bool m_mouseDown;
 		QPointF m_mouseDownPos; //position of last mouse-down event in local coordinates
+		QPoint m_gridPosition;
         JollyType m_jollyType;
 };
 
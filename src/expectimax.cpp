@@ -0,0 +1,152 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "expectimax.h"
+
+#include <algorithm>
+
+//the clock is only read every few chance nodes
+static const int ClockInterval = 16;
+
+KDiamond::ExpectimaxOptions::ExpectimaxOptions()
+	: depth(2)
+	, samples(4)
+	, branching(6)
+	, budgetMilliseconds(0)
+	, pointsPerSecond(DefaultPointsPerSecond)
+{
+}
+
+KDiamond::ExpectimaxStrategy::ExpectimaxStrategy(const ExpectimaxOptions& options, int seed)
+	: m_options(options)
+	, m_rng(seed)
+	, m_deadline(0)
+	, m_nodes(0)
+	, m_timeUp(false)
+	, m_completedDepth(0)
+{
+	m_options.depth = std::max(1, m_options.depth);
+	m_options.samples = std::max(1, m_options.samples);
+	m_options.branching = std::max(1, m_options.branching);
+	m_orders.resize(m_options.depth + 1);
+}
+
+bool KDiamond::ExpectimaxStrategy::isTimeUp()
+{
+	if (!m_timeUp && m_deadline && ++m_nodes % ClockInterval == 0)
+		m_timeUp = clockMicroseconds() >= m_deadline;
+	return m_timeUp;
+}
+
+void KDiamond::ExpectimaxStrategy::orderMoves(const HeadlessGame& game, std::vector<int>& order) const
+{
+	const std::vector<Swap>& moves = game.moves();
+	order.resize(moves.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&moves](int a, int b)
+	{
+		return moves[a].numToDelete() > moves[b].numToDelete();
+	});
+}
+
+double KDiamond::ExpectimaxStrategy::moveValue(const HeadlessGame& game, int move, int depth)
+{
+	//the scratch game of this depth is overwritten for every sample
+	HeadlessGame& child = m_games[depth];
+	double total = 0.0;
+	for (int sample = 0; sample < m_options.samples; ++sample)
+	{
+		child = game;
+		double value = KDiamond::moveValue(child.play(move, m_rng), m_options.pointsPerSecond);
+		if (depth > 1 && !child.isFinished())
+			value += bestValue(child, depth - 1);
+		total += value;
+		if (isTimeUp())
+			return 0.0; //the iteration is discarded anyway
+	}
+	return total / m_options.samples;
+}
+
+double KDiamond::ExpectimaxStrategy::bestValue(const HeadlessGame& game, int depth)
+{
+	std::vector<int>& order = m_orders[depth];
+	orderMoves(game, order);
+	const int count = std::min<int>(order.size(), m_options.branching);
+	double best = 0.0;
+	for (int i = 0; i < count && !m_timeUp; ++i)
+		best = std::max(best, moveValue(game, order[i], depth));
+	return best;
+}
+
+int KDiamond::ExpectimaxStrategy::chooseMove(const HeadlessGame& game)
+{
+	if (m_games.empty())
+		m_games.assign(m_options.depth + 1, game);
+	m_deadline = m_options.budgetMilliseconds > 0 ? clockMicroseconds() + 1000LL * m_options.budgetMilliseconds : 0;
+	m_nodes = 0;
+	m_completedDepth = 0;
+	std::vector<int>& order = m_orders[0];
+	orderMoves(game, order);
+	int bestMove = order[0];
+	for (int depth = 1; depth <= m_options.depth; ++depth)
+	{
+		//the first iteration always completes, so that a move is chosen on merit
+		m_timeUp = false;
+		const long long deadline = m_deadline;
+		if (depth == 1)
+			m_deadline = 0;
+		int iterationBest = order[0];
+		double iterationValue = -1.0;
+		for (size_t i = 0; i < order.size() && !m_timeUp; ++i)
+		{
+			const double value = moveValue(game, order[i], depth);
+			if (value > iterationValue)
+			{
+				iterationValue = value;
+				iterationBest = order[i];
+			}
+		}
+		m_deadline = deadline;
+		if (m_timeUp)
+			break;
+		bestMove = iterationBest;
+		m_completedDepth = depth;
+		//search the best move first in the next iteration
+		std::stable_partition(order.begin(), order.end(), [bestMove](int move) { return move == bestMove; });
+		if (m_deadline && clockMicroseconds() >= m_deadline)
+			break;
+	}
+	return bestMove;
+}
+
+#ifdef UNITTEST
+#include <gtest/gtest.h>
+
+TEST(Expectimax, deterministicWithoutBudget){
+    KDiamond::HeadlessGame game(0);
+    cpputils::ParRap rng(42);
+    game.start(rng);
+    KDiamond::ExpectimaxStrategy a(KDiamond::ExpectimaxOptions(), 7), b(KDiamond::ExpectimaxOptions(), 7);
+    const int move = a.chooseMove(game);
+    ASSERT_GE(move, 0);
+    ASSERT_LT(move, (int) game.moves().size());
+    EXPECT_EQ(move, b.chooseMove(game));
+    EXPECT_EQ(2, a.completedDepth());
+}
+#endif //UNITTEST
@@ -0,0 +1,79 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_EXPECTIMAX_H
+#define KDIAMOND_EXPECTIMAX_H
+
+#include "headless-game.h"
+#include "rng.h"
+
+#include <vector>
+
+namespace KDiamond
+{
+	struct ExpectimaxOptions
+	{
+		int depth; //number of own moves to look ahead (at least 1)
+		int samples; //sampled refills per chance node
+		int branching; //moves considered below the root (the most promising ones)
+		int budgetMilliseconds; //time per decision, 0 for no limit
+		double pointsPerSecond; //see KDiamond::moveValue
+
+		ExpectimaxOptions();
+	};
+
+	//Depth-limited expectimax search over KDiamond::HeadlessGame. Each move is
+	//played completely, i.e. with its whole cascade, and the random refills are
+	//chance nodes, whose value is estimated from a number of sampled refills.
+	//Moves are scored by their points plus the earned time (which gives more
+	//moves in timed games).
+	//
+	//Moves are ordered by the number of diamonds they remove immediately, and
+	//below the root only the best few of them are searched. With a time budget,
+	//the search deepens iteratively and returns the best move of the deepest
+	//completed iteration; the first iteration (one move deep) always completes.
+	class ExpectimaxStrategy
+	{
+		public:
+			explicit ExpectimaxStrategy(const ExpectimaxOptions& options = ExpectimaxOptions(), int seed = -1);
+			void seed(int seed) { m_rng.seed(seed); }
+			int chooseMove(const HeadlessGame& game);
+
+			//depth of the last completed iteration of chooseMove()
+			int completedDepth() const { return m_completedDepth; }
+		private:
+			//expected value of playing the given move, searching depth moves deep
+			double moveValue(const HeadlessGame& game, int move, int depth);
+			//value of the best of the most promising moves
+			double bestValue(const HeadlessGame& game, int depth);
+			//the available moves of game, most promising first
+			void orderMoves(const HeadlessGame& game, std::vector<int>& order) const;
+			bool isTimeUp();
+
+			ExpectimaxOptions m_options;
+			cpputils::ParRap m_rng;
+			std::vector<HeadlessGame> m_games; //one scratch game per search depth
+			std::vector<std::vector<int> > m_orders; //one move order per search depth
+			long long m_deadline; //in microseconds of the steady clock, 0 for no deadline
+			int m_nodes;
+			bool m_timeUp;
+			int m_completedDepth;
+	};
+}
+
+#endif // KDIAMOND_EXPECTIMAX_H
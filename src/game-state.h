@@ -19,6 +19,8 @@
 #ifndef KDIAMOND_GAMESTATE_H
 #define KDIAMOND_GAMESTATE_H
 
+#include "board-model.h"
+
 #include <QObject>
 
 namespace KDiamond
@@ -26,9 +28,6 @@ namespace KDiamond
 
 	class GameStatePrivate;
 
-	//base duration of a game in seconds
-	const int GameDuration = 200;
-
 	enum Mode
 	{
 		NormalGame,
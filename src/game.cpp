@@ -17,9 +17,13 @@
  ***************************************************************************/
 
 #include "game.h"
+#include "background-renderer.h"
 #include "board.h"
 #include "diamond.h"
+#include "rng.h"
 #include "settings.h"
+#include "sprite-prewarmer.h"
+#include "trace.h"
 
 #include <cmath>
 #include <QPainter>
@@ -32,8 +36,32 @@
 #include <KNotification>
 
 
-#include <iostream>
-using namespace std;
+
+//time without further resize events after which the scene graphics are updated (in milliseconds)
+static const int ResizeDelay = 100;
+
+//names of the KDiamond::Job values
+static const char* const g_jobNames[KDiamond::JobStats::MaxJobs] = {
+	0, "SwapDiamondsJob", "RemoveFiguresJob", "RevokeSwapDiamondsJob",
+	"FillGapsJob", "UpdateAvailableMovesJob", "EndGameJob", 0
+};
+
+static KDiamond::JobStats g_totalJobStats;
+
+const KDiamond::JobStats& KDiamond::totalJobStats()
+{
+	return g_totalJobStats;
+}
+
+std::string KDiamond::jobStatsSummary(const JobStats& stats)
+{
+	return stats.summary(g_jobNames);
+}
+
+static long long microsecondsSince(const std::chrono::steady_clock::time_point& start)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
 
 //BEGIN global KGameRenderer instance
 
@@ -52,7 +80,7 @@ namespace KDiamond
 	class Renderer : public KGameRenderer
 	{
 		public:
-			Renderer() : KGameRenderer(new ThemeProvider, 10)
+			Renderer() : KGameRenderer(new ThemeProvider, Settings::rendererCacheSize())
 			{
 				setFrameSuffix(QString::fromLatin1("-%1"));
 			}
@@ -68,65 +96,100 @@ KGameRenderer* KDiamond::renderer()
 
 //END global KGameRenderer instance
 
-const int UpdateInterval = 40;
+//picks a random seed for seed <= 0 (same convention as the generators in rng.h)
+static int gameSeed(int seed)
+{
+	while (seed <= 0)
+		seed = cpputils::randomSeed();
+	return seed;
+}
 
-Game::Game(KDiamond::GameState* state)
-	: m_timerId(-1)
-	, m_board(new KDiamond::Board(g_renderer))
+Game::Game(KDiamond::GameState* state, int seed)
+	: m_seed(gameSeed(seed))
+	, m_rng(new cpputils::RandomSourceOf<cpputils::ParRap>(m_seed))
+	, m_timerId(-1)
+	, m_swapDelay(Settings::swapDelay())
+	, m_pacingTimerId(-1)
+	, m_resizeTimerId(-1)
+	, m_waitingForAnimations(false)
+	, m_moveRunning(false)
+	, m_cascadeDepth(0)
+	, m_swapPaced(false)
+	, m_turbo(Settings::turbo())
+	, m_board(new KDiamond::Board(g_renderer, *m_rng))
 	, m_gameState(state)
 	, m_messenger(new KGamePopupItem)
+	, m_prewarmer(new KDiamond::SpritePrewarmer(g_renderer, this))
+	, m_backgroundRenderer(new KDiamond::BackgroundRenderer(g_renderer, this))
 {
+	connect(m_prewarmer, SIGNAL(finished()), SLOT(prewarmFinished()));
+	connect(m_backgroundRenderer, SIGNAL(ready(QPixmap)), SLOT(setBackground(QPixmap)));
 	connect(m_board, SIGNAL(animationsFinished()), SLOT(animationFinished()));
 	connect(m_board, SIGNAL(clicked(QPoint)), SLOT(clickDiamond(QPoint)));
 	connect(m_board, SIGNAL(dragged(QPoint,QPoint)), SLOT(dragDiamond(QPoint,QPoint)));
 	//init scene (with some default scene size that makes board coordinates equal scene coordinates)
 	const int minSize = m_board->gridSize();
 	setSceneRect(0.0, 0.0, minSize, minSize);
-	connect(this, SIGNAL(sceneRectChanged(QRectF)), SLOT(updateGraphics()));
+	connect(this, SIGNAL(sceneRectChanged(QRectF)), SLOT(sceneResized()));
 	connect(g_renderer->themeProvider(), SIGNAL(currentThemeChanged(const KgTheme*)), SLOT(updateGraphics()));
 	addItem(m_board);
 	//init messenger
 	m_messenger->setMessageOpacity(0.8);
 	m_messenger->setHideOnMouseClick(false);
 	addItem(m_messenger);
-	//init time management
-	m_timerId = startTimer(UpdateInterval);
+	m_board->setAnimated(!m_turbo);
 	//schedule late initialisation
 	m_jobQueue << KDiamond::UpdateAvailableMovesJob;
+	scheduleJobs();
 
 //	//INIZIALIZZO IL RANDOM PLAYER
 //	m_player = new Player(this);
 }
 
+Game::~Game()
+{
+	g_totalJobStats.merge(m_jobStats);
+}
+
+int Game::seed() const
+{
+	return m_seed;
+}
+
+const KDiamond::JobStats& Game::jobStats() const
+{
+	return m_jobStats;
+}
+
+
+//converts the cells of a figure found by the board model into grid coordinates
+static QVector<QPoint> figurePoints(const KDiamond::BoardModel& model, const KDiamond::Match& figure)
+{
+	QVector<QPoint> points(figure.count);
+	for (int i = 0; i < figure.count; ++i)
+		points[i] = QPoint(model.x(figure.cells[i]), model.y(figure.cells[i]));
+	return points;
+}
 
 //Checks amount of possible moves remaining
 void Game::getMoves(){
 	m_availableMoves.clear();
-	const int gridSize = m_board->gridSize();
-	for (QPoint point; point.x() < gridSize - 1; ++point.rx()){
-		for (point.ry() = 0; point.y() < gridSize - 1; ++point.ry()){
-			if(!m_board->hasDiamond(point)) continue;
-             //guardo solo a sinistra e in basso, gli altri casi sono considerati
-             //dagli altri punti
-            QVector<QPoint> destinations;
-            destinations.append(point + QPoint(1, 0));
-            destinations.append(point + QPoint(0, 1));
-            for(auto dest : destinations){
-                if(m_board->hasDiamond(dest)){
-                    m_board->swapDiamonds(point, dest, false); //senza animazione
-                    auto figure1 = findFigure(point).points();
-                    auto figure2 = findFigure(dest).points();
-                    //se la mossa ha successo
-                    if(!(figure1.isEmpty() && figure2.isEmpty())){
-                        Move mov(point, dest);
-                        mov.m_toDelete = figure1 + figure2;
-                        m_availableMoves.append(mov);
-                    }
-                    m_board->swapDiamonds(point, dest, false); //senza animazione
-                }
-            }
-        }
-    }
+	//only the moves near the cells changed by the last cascade are re-evaluated
+	m_board->updateMoves(m_moveIndex);
+	const KDiamond::BoardModel& model = m_board->model();
+	std::vector<KDiamond::Swap> swaps;
+	m_moveIndex.swaps(swaps);
+	KDiamond::MaskedRefills refills;
+	for (const KDiamond::Swap& swap : swaps){
+		Move mov(QPoint(model.x(swap.from), model.y(swap.from)), QPoint(model.x(swap.to), model.y(swap.to)));
+		mov.m_toDelete = figurePoints(model, swap.figure1) + figurePoints(model, swap.figure2);
+		//play out the whole cascade on a scratch board
+		const KDiamond::MoveResult& result = m_moveEvaluator.evaluate(model, swap, refills).result;
+		mov.m_points = result.points;
+		mov.m_levels = result.levels;
+		mov.m_earnedMilliseconds = result.earnedMilliseconds;
+		m_availableMoves.append(mov);
+	}
 
     emit numberMoves(m_availableMoves.size());
     if (m_availableMoves.isEmpty()){
@@ -135,9 +198,63 @@ void Game::getMoves(){
 	}
 }
 
+//Resize events arrive in bursts while the user drags the window border. The
+//background is only stretched during the burst (see drawBackground()), and
+//the sprites are rendered once the size has settled.
+void Game::sceneResized()
+{
+	//nothing to stretch yet
+	if (m_background.isNull())
+	{
+		updateGraphics();
+		return;
+	}
+	if (m_resizeTimerId != -1)
+		killTimer(m_resizeTimerId);
+	m_resizeTimerId = startTimer(ResizeDelay);
+	//keep the board inside the window meanwhile
+	updateBoardTransform();
+}
+
 void Game::updateGraphics()
 {
-    cout << "updateGraphics" << endl;
+	if (m_resizeTimerId != -1)
+	{
+		killTimer(m_resizeTimerId);
+		m_resizeTimerId = -1;
+	}
+	const QSize sceneSize = sceneRect().size().toSize();
+	KDIAMOND_TRACE(TraceInfo, TraceRendering, "updating graphics for %dx%d", sceneSize.width(), sceneSize.height());
+	const int diamondSize = updateBoardTransform();
+	const int boardSize = m_board->gridSize() * diamondSize;
+	const int leftOffset = (sceneSize.width() - boardSize) / 2.0;
+	//render the diamonds at their new size before the board becomes interactive
+	if (diamondSize > 0)
+	{
+		QStringList spriteKeys;
+		spriteKeys << colorKey(KDiamond::Selection);
+		for (int color = KDiamond::RedDiamond; color <= m_board->model().colorCount(); ++color)
+			spriteKeys << colorKey((KDiamond::Color) color);
+		m_board->setEnabled(false);
+		m_prewarmer->start(spriteKeys, QSize(diamondSize, diamondSize));
+	}
+	//render background (the current one is stretched until the new one arrives)
+	QRect borderRect;
+	const KgTheme* theme = g_renderer->theme();
+	const bool hasBorder = theme->customData("HasBorder").toInt() > 0;
+	if (hasBorder)
+	{
+		const qreal borderPercentage = theme->customData("BorderPercentage").toFloat();
+		const int padding = borderPercentage * boardSize;
+		const int boardBorderSize = 2 * padding + boardSize;
+		borderRect = QRect(leftOffset - padding, -padding, boardBorderSize, boardBorderSize);
+	}
+	m_backgroundRenderer->request(sceneSize, borderRect);
+}
+
+//Fits the board into the scene and returns the new diamond size.
+int Game::updateBoardTransform()
+{
 	//calculate new metrics
 	const QSize sceneSize = sceneRect().size().toSize();
 	const int gridSize = m_board->gridSize();
@@ -150,20 +267,21 @@ void Game::updateGraphics()
 	QTransform t;
 	t.translate(leftOffset, 0).scale(diamondSize, diamondSize);
 	m_board->setTransform(t);
-	//render background
-	QPixmap pix = g_renderer->spritePixmap("kdiamond-background", sceneSize);
-	const KgTheme* theme = g_renderer->theme();
-	const bool hasBorder = theme->customData("HasBorder").toInt() > 0;
-	if (hasBorder)
-	{
-		const qreal borderPercentage = theme->customData("BorderPercentage").toFloat();
-		const int padding = borderPercentage * boardSize;
-		const int boardBorderSize = 2 * padding + boardSize;
-		const QPixmap boardPix = g_renderer->spritePixmap("kdiamond-border", QSize(boardBorderSize, boardBorderSize));
-		QPainter painter(&pix);
-		painter.drawPixmap(QPoint(leftOffset - padding, -padding), boardPix);
-	}
-	setBackgroundBrush(pix);
+	return diamondSize;
+}
+
+void Game::setBackground(const QPixmap& background)
+{
+	m_background = background;
+	invalidate(sceneRect(), QGraphicsScene::BackgroundLayer);
+}
+
+void Game::drawBackground(QPainter* painter, const QRectF& rect)
+{
+	Q_UNUSED(rect)
+	//while a new background is being rendered, the previous one is stretched over the scene
+	if (!m_background.isNull())
+		painter->drawPixmap(sceneRect(), m_background, m_background.rect());
 }
 
 void Game::clickDiamond(const QPoint& point)
@@ -185,6 +303,7 @@ void Game::clickDiamond(const QPoint& point)
 	m_board->setSelection(point, !isSelected);
 	if (m_board->selections().count() == 2){
 		m_jobQueue << KDiamond::SwapDiamondsJob;
+		scheduleJobs();
     }
 }
 
@@ -202,33 +321,70 @@ void Game::dragDiamond(const QPoint& point, const QPoint& direction)
 		m_board->setSelection(point, true);
 		m_board->setSelection(point2, true);
 		m_jobQueue << KDiamond::SwapDiamondsJob;
+		scheduleJobs();
 	}
 }
 
-void Game::sleep(int ms) const{
-#ifdef Q_OS_WIN
-    Sleep(uint(ms));
-#else
-    struct timespec ts = { ms / 1000, (ms % 1000) * 1000 * 1000 };
-    nanosleep(&ts, NULL);
-#endif
+void Game::setTurbo(bool turbo)
+{
+	if (m_turbo == turbo)
+		return;
+	m_turbo = turbo;
+	m_board->setAnimated(!turbo);
 }
 
-void Game::timerEvent(QTimerEvent* event)
+//The job queue is event-driven: the job timer (with zero interval) only runs
+//while jobs can be executed. It is stopped while animations are running, during
+//the swap delay and during pauses, and scheduleJobs() is called again when
+//these have finished or when new jobs have been queued.
+void Game::scheduleJobs()
+{
+	if (m_timerId == -1)
+		m_timerId = startTimer(0);
+}
+
+void Game::stopJobs()
+{
+	if (m_timerId != -1)
+	{
+		killTimer(m_timerId);
+		m_timerId = -1;
+	}
+}
+
+bool Game::canRunJobs() const
 {
-    //cout << "timerEvent" << endl;
+	return m_pacingTimerId == -1 && m_gameState->state() != KDiamond::Paused && !m_board->hasRunningAnimations()
+		&& !m_prewarmer->isActive();
+}
 
+void Game::timerEvent(QTimerEvent* event)
+{
+	//the window size has settled -> render the graphics for the new size
+	if (event->timerId() == m_resizeTimerId)
+	{
+		updateGraphics();
+		return;
+	}
+	//the swap delay has elapsed -> resume the job queue
+	if (event->timerId() == m_pacingTimerId)
+	{
+		killTimer(m_pacingTimerId);
+		m_pacingTimerId = -1;
+		m_swapPaced = true;
+		scheduleJobs();
+		return;
+	}
 	//propagate event to superclass if necessary
 	if (event->timerId() != m_timerId)
 	{
 		QGraphicsScene::timerEvent(event);
 		return;
 	}
-	//do not handle any jobs while animations are running
-	if (m_gameState->state() == KDiamond::Paused || m_board->hasRunningAnimations())
+	//do not handle any jobs while animations are running etc.
+	if (!canRunJobs())
 	{
-		killTimer(m_timerId);
-		m_timerId = -1;
+		stopJobs();
 		return;
 	}
 
@@ -237,28 +393,61 @@ void Game::timerEvent(QTimerEvent* event)
 	{ /***IMPLEMENTO QUI IL RANDOM PLAYER*****/
         if(m_availableMoves.size() > 0){
             m_board->clearSelection();
-            auto m = m_availableMoves[qrand() % m_availableMoves.size()];
+            auto m = m_availableMoves[m_rng->unifInt(m_availableMoves.size())];
             clickDiamond(m.from());
             clickDiamond(m.to());
-            cout << "MOVE :  " << m.from().x() << "  " << m.from().y() << " --> " << m.to().x() << "  " << m.to().y() <<  endl;
-//                cout << "*****MOVES********" << endl;
-//            for(auto M : m_availMoves){
-//                cout << "M :  " << M.first.x() << "  " << M.first.y() << " --> " << M.second.x() << "  " << M.second.y() <<  endl;
-//            }
+            KDIAMOND_TRACE(TraceDebug, TraceJobs, "random move (%d,%d) -> (%d,%d)", m.from().x(), m.from().y(), m.to().x(), m.to().y());
         }
-        return;
+		else
+		{
+			//nothing to do until new jobs are scheduled
+			stopJobs();
+			return;
+		}
 	}
-	//execute next job in queue
-	const KDiamond::Job job = m_jobQueue.takeFirst();
+	//execute the jobs back-to-back until one of them starts animations (the
+	//queue resumes in animationFinished()) or the queue is empty; at most one
+	//move of the random player is made per timer event
+	while (!m_jobQueue.isEmpty())
+	{
+		const KDiamond::Job job = m_jobQueue.takeFirst();
+		const std::chrono::steady_clock::time_point jobStart = std::chrono::steady_clock::now();
+		runJob(job);
+		m_jobStats.jobs[job].add(microsecondsSince(jobStart));
+		if (m_board->hasRunningAnimations() && !m_waitingForAnimations)
+		{
+			m_waitingForAnimations = true;
+			m_animationStart = std::chrono::steady_clock::now();
+		}
+		if (m_timerId == -1)
+			return; //the game has ended
+		if (!canRunJobs())
+		{
+			stopJobs();
+			return;
+		}
+	}
+}
+
+void Game::runJob(KDiamond::Job job)
+{
 	switch (job)
 	{
 		case KDiamond::SwapDiamondsJob: {
+			const bool paced = m_swapPaced;
+			m_swapPaced = false;
 			if (m_board->selections().count() != 2)
 				break; //this can be the case if, during a cascade, two diamonds are selected (inserts SwapDiamondsJob) and then deselected
+			if (!paced && m_swapDelay > 0 && !m_turbo)
+			{
+				//keep the selection visible for a moment, then come back to this job
+				m_jobQueue.prepend(KDiamond::SwapDiamondsJob);
+				m_pacingTimerId = startTimer(m_swapDelay);
+				break;
+			}
 			//ensure that the selected diamonds are neighbors (this is not necessarily the case as diamonds can move to fill gaps)
 			const QList<QPoint> points = m_board->selections();
-			cout << "SWAPPING" << endl;
-            sleep(1000); //Sennò non si vede un cazzo
+			KDIAMOND_TRACE(TraceDebug, TraceJobs, "swapping (%d,%d) and (%d,%d)", points[0].x(), points[0].y(), points[1].x(), points[1].y());
 			m_board->clearSelection();
 			const int dx = qAbs(points[0].x() - points[1].x());
 			const int dy = qAbs(points[0].y() - points[1].y());
@@ -266,6 +455,9 @@ void Game::timerEvent(QTimerEvent* event)
 				break;
 			//start a new cascade
 			m_gameState->resetCascadeCounter();
+			m_moveStart = std::chrono::steady_clock::now();
+			m_moveRunning = true;
+			m_cascadeDepth = 0;
 			//copy selection info into another storage (to allow the user to select the next two diamonds while the cascade runs)
 			m_swappingDiamonds = points;
 			m_jobQueue << KDiamond::RemoveFiguresJob; //We already insert this here to avoid another conditional statement.
@@ -277,19 +469,22 @@ void Game::timerEvent(QTimerEvent* event)
 			break;
 
 		case KDiamond::RemoveFiguresJob: {
-            cout<<"Job::RemoveRowJob" << endl;
 			const QVector<Figure> figuresToRemove = findFigures();
-            cout<<"Num figures to remove =" << figuresToRemove.size() << endl;
+			KDIAMOND_TRACE(TraceDebug, TraceJobs, "removing %d figures", figuresToRemove.size());
 			if (figuresToRemove.isEmpty()){
 				//no diamond rows were formed by the last move -> revoke movement (unless we are in a cascade)
 				if (!m_swappingDiamonds.isEmpty()){
 					m_jobQueue.prepend(KDiamond::RevokeSwapDiamondsJob);
+					m_moveRunning = false; //revoked moves are not measured
 				}
 				else {
                     m_jobQueue << KDiamond::UpdateAvailableMovesJob;
+                    finishMove();
                 }
 			}
 			else{ //C'è qualcosa da rimuovere
+				m_jobStats.figuresFound += figuresToRemove.size();
+				++m_cascadeDepth;
 
 				//all moves may now be out-dated - flush the moves list
 				if (!m_availableMoves.isEmpty()){
@@ -311,13 +506,13 @@ void Game::timerEvent(QTimerEvent* event)
 				KNotification::event("remove");
 
 				              //Segno i punti ed elimino le figure
-                cout<<"### Removing Figures" << endl;
 //                printBoard();
                 for(const auto& fig : figuresToRemove){
                     //invoke remove animation, then fill gaps immediately after the animation
                     for(const QPoint& diamondPos: fig.points()){
-                        if(m_board->hasDiamond(diamondPos)){ //potrebbe essere (casi rari) che era già stato scoppiato
-                            if(m_board->diamond(diamondPos)->isJolly()){
+                        if(m_board->diamond(diamondPos)){ //potrebbe essere (casi rari) che era già stato scoppiato
+                            const KDiamond::BoardModel& model = m_board->model();
+                            if(model.jollyType(model.index(diamondPos.x(), diamondPos.y())) != JollyType::None){
                                 removeJolly(diamondPos);
                             }
                             else {
@@ -343,24 +538,24 @@ void Game::timerEvent(QTimerEvent* event)
 			break;
 		case KDiamond::EndGameJob:
 			emit pendingAnimationsFinished();
-			killTimer(m_timerId);
-			m_timerId = -1;
+			stopJobs();
 			break;
 	}
 }
 
 void Game::removeDiamond(const QPoint& point){
-    cout << "SCOPPIO Diamante"  <<" in " << point.x() << " " << point.y() << endl;
+    KDIAMOND_TRACE(TraceDebug, TraceJobs, "removing diamond at (%d,%d)", point.x(), point.y());
     m_gameState->addPoints(1);
     m_board->removeDiamond(point);
-    cout << "SCOPPIATO" << endl;
+    ++m_jobStats.diamondsRemoved;
 }
 
 
 //TODO Inserire busta e cookie
 void Game::removeJolly(const QPoint& point){
-    cout << "SCOPPIO Jolly"  <<" in " << point.x() << " " << point.y() << endl;
-    auto jtype = m_board->diamond(point)->jollyType();
+    const KDiamond::BoardModel& model = m_board->model();
+    auto jtype = model.jollyType(model.index(point.x(), point.y()));
+    KDIAMOND_TRACE(TraceDebug, TraceJobs, "removing jolly %d at (%d,%d)", (int) jtype, point.x(), point.y());
     removeDiamond(point);
 
 
@@ -384,16 +579,40 @@ void Game::showHint()
 {
 	if (m_availableMoves.isEmpty() || !m_board->selections().isEmpty())
 		return;
-	auto m = m_availableMoves.value(qrand() % m_availableMoves.size());
+	//show the move with the most points
+	auto m = m_availableMoves.first();
+	for (const Move& move : m_availableMoves)
+		if (move.points() > m.points())
+			m = move;
 	m_board->setSelection(m.from(), true);
     m_board->setSelection(m.to(), true);
 	m_gameState->removePoints(3);
 }
 
+//the board has settled after a move
+void Game::finishMove()
+{
+	if (!m_moveRunning)
+		return;
+	m_moveRunning = false;
+	m_jobStats.moveLatency.add(microsecondsSince(m_moveStart));
+	m_jobStats.addCascade(m_cascadeDepth);
+}
+
+void Game::prewarmFinished()
+{
+	m_board->setEnabled(true);
+	scheduleJobs();
+}
+
 void Game::animationFinished()
 {
-	if (m_timerId == -1)
-		m_timerId = startTimer(UpdateInterval);
+	if (m_waitingForAnimations)
+	{
+		m_waitingForAnimations = false;
+		m_jobStats.animationWait.add(microsecondsSince(m_animationStart));
+	}
+	scheduleJobs();
 }
 
 void Game::stateChange(KDiamond::State state)
@@ -404,10 +623,10 @@ void Game::stateChange(KDiamond::State state)
 		case KDiamond::Finished:
 			m_board->clearSelection();
 			m_jobQueue << KDiamond::EndGameJob;
+			scheduleJobs();
 			break;
 		case KDiamond::Playing:
-			if (m_timerId == -1)
-				m_timerId = startTimer(UpdateInterval);
+			scheduleJobs();
 			break;
 	}
 }
@@ -425,132 +644,17 @@ const QVector<Move>& Game::availMoves() const{
 }
 
 
-//ritorna la riga verticale contenente il punto (escluso il punto stesso)
-QVector<QPoint> Game::findRowV(const QPoint& point){
-    QVector<QPoint> row;
-    #define C(X, Y) (m_board->hasDiamond(QPoint(X, Y)) ? m_board->diamond(QPoint(X, Y))->color() : KDiamond::Selection)
-    auto currColor = m_board->diamond(point)->color();  //ATTENZIONE Non controllo che il colore sia valido (!=Selection)
-    int yt = point.y() + 1;
-    const int x = point.x();
-    while(C(x, yt) == currColor){ //ciclo verso il basso
-        row.append(QPoint(x, yt));
-        yt++;
-    }
-
-    yt = point.y() - 1;
-    while(C(x, yt) == currColor){ //ciclo verso l'alto
-        row.append(QPoint(x, yt));
-        yt--;
-    }
-    #undef C
-    return row;
-}
-
-//ritorna la riga orizzontale contenente il punto (escluso il punto stesso)
-QVector<QPoint> Game::findRowH(const QPoint& point){
-    QVector<QPoint> row;
-    #define C(X, Y) (m_board->hasDiamond(QPoint(X, Y)) ? m_board->diamond(QPoint(X, Y))->color() : KDiamond::Selection)
-    auto currColor = m_board->diamond(point)->color();  //ATTENZIONE Non controllo che il colore sia valido (!=Selection)
-    int xt = point.x() + 1;
-    const int y = point.y();
-    while(C(xt, y) == currColor){ //ciclo verso destra
-        row.append(QPoint(xt, y));
-        xt++;
-    }
-
-    xt = point.x() - 1;
-    while(C(xt, y) == currColor){ //ciclo verso sinistra
-        row.append(QPoint(xt, y));
-        xt--;
-    }
-    #undef C
-    return row;
-}
-
-
 QVector<Figure> Game::findFigures(){
 	QVector<Figure> diamonds;
-	const int gridSize = m_board->gridSize();
-	QVector<bool> inFigure(gridSize * gridSize, false);
-	for (QPoint point; point.x() < gridSize; ++point.rx()){
-		for (point.ry() = 0; point.y() < gridSize ; ++point.ry()){
-            //controllo che ci sia un diamante e che non sia già parte di una figura
-            if(m_board->hasDiamond(point) && !inFigure[point.x() + gridSize * point.y()]){
-                auto figure = findFigure(point);
-                for(auto& p : figure.points()){
-                    inFigure[p.x() + gridSize * p.y()] = true;
-                }
-                if (figure.size() > 0){
-                    diamonds += figure;
-                }
-            }
-        }
+	const KDiamond::BoardModel& model = m_board->model();
+	std::vector<KDiamond::Match> figures;
+	model.findFigures(figures);
+	for (const KDiamond::Match& figure : figures){
+		diamonds += Figure(figurePoints(model, figure), figure.type);
 	}
-
 	return diamonds;
 }
 
-Figure Game::findFigure(QPoint point){
-    auto rH = findRowH(point);
-    auto rV = findRowV(point);
-
-    FigureType type;
-    QVector<QPoint> points;
-    //Controllo che figura ho trovato. Si può rendere pìù efficiente
-    if(rH.size() >= 2 && rV.size() < 2){
-    //riga orizzontale
-        points.append(point);
-        points += rH;
-        type = FigureType::RowH;
-        //controllo se si crea una T o una L
-        for(auto p : rH){
-            auto rV2 = findRowV(p);
-            if(rV2.size() >= 2){
-                points += rV2;
-                type = FigureType::LT;
-                //ATTENZIONE si possono avere più file verticali o posso
-                //mettere un break?
-                //direi che non si possono avere più righe verticali: al massimo
-                //se ne forma una
-                break;
-            }
-        }
-    } else if(rH.size() < 2 && rV.size() >= 2){
-    // riga verticale
-        points.append(point);
-        points += rV;
-        type = FigureType::RowV;
-        //controllo se si crea una T o una L
-        for(auto p : rV){
-            auto rH2 = findRowH(p);
-            if(rH2.size() >= 2){
-                points += rH2;
-                type = FigureType::LT;
-                //ATTENZIONE si possono avere più file verticali o posso
-                //mettere un break?
-                // direi che non si possono creare
-                break;
-            }
-        }
-
-    } else if(rH.size() >= 2 && rV.size() >= 2){
-        //ho trovato una T o una L
-        points.append(point);
-        points += rH;
-        points += rV;
-        type = FigureType::LT;
-        //ATTENZIONE non controllo la creazione di figure più complesse
-        // che si potrebbero formare quando calano i diamanti dall'alto
-
-        //qua se rH.size()=2 e rV.size()=2 allora devi creare una busta in point
-        //se però, per esempio, rH.size()=3 e rV.size()=2, c'è un conflitto:
-        //-creo un jolly verticale in point?
-        //-creo sempre una busta in point?
-    }
-
-    return Figure(points, type);
-}
-
 
 
 #include "game.moc"
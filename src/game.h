@@ -20,25 +20,35 @@
 #define KDIAMOND_GAME_H
 
 class Diamond;
+#include "board-model.h"
 #include "game-state.h"
+#include "job-stats.h"
+#include "move-evaluator.h"
+#include "move-index.h"
 
 class QAbstractAnimation;
 #include <QGraphicsScene>
 class KGamePopupItem;
 class KGameRenderer;
+namespace cpputils
+{
+	class RandomSource;
+}
 
-#include <ctime> //per pause()
+#include <chrono>
+#include <memory>
+#include <string>
 #include <utility>
 using namespace std;
 
-#ifdef Q_OS_WIN
-#include <windows.h> // for Sleep
-#endif
 
 
 
 
 namespace KDiamond{
+	class BackgroundRenderer;
+	class SpritePrewarmer;
+
 	//jobs to be done during the board update
     enum  Job {
             SwapDiamondsJob = 1, //swap selected diamonds
@@ -51,14 +61,11 @@ namespace KDiamond{
 	class Board;
 
 	KGameRenderer* renderer();
-}
 
-enum class FigureType {
-    None,
-    RowH = 1,
-    RowV,
-    LT
-};
+	//statistics of all games which have been deleted so far
+	const JobStats& totalJobStats();
+	std::string jobStatsSummary(const JobStats& stats);
+}
 
 class Figure{
 public:
@@ -92,7 +99,10 @@ public:
 
     Move(const QPoint& from, const QPoint& to)
         : m_from(from)
-        , m_to(to){}
+        , m_to(to)
+        , m_points(0)
+        , m_levels(0)
+        , m_earnedMilliseconds(0){}
 
     QPoint from() const{
         return m_from;
@@ -110,18 +120,41 @@ public:
         return m_toDelete.size();
     }
 
+    //Outcome of the complete cascade of this move, not counting the figures
+    //which would depend on the unknown refills (see KDiamond::MaskedRefills).
+    int points() const{
+        return m_points;
+    }
+
+    int cascadeLevels() const{
+        return m_levels;
+    }
+
+    int earnedMilliseconds() const{
+        return m_earnedMilliseconds;
+    }
+
 
 private:
     QPoint m_from;
     QPoint m_to;
     QVector<QPoint> m_toDelete;
+    int m_points, m_levels, m_earnedMilliseconds;
 };
 
 class Game : public QGraphicsScene
 {
 	Q_OBJECT
 	public:
-		Game(KDiamond::GameState* state);
+		//The board, the refills and the moves of the random player are drawn from
+		//a generator owned by this game, so that the game can be reproduced from
+		//its seed. A seed <= 0 picks a random seed.
+		Game(KDiamond::GameState* state, int seed = -1);
+		~Game();
+
+		int seed() const;
+		//instrumentation of the job queue of this game
+		const KDiamond::JobStats& jobStats() const;
 	public Q_SLOTS:
 		void updateGraphics();
 
@@ -132,34 +165,58 @@ class Game : public QGraphicsScene
 		void message(const QString &message);
 		void stateChange(KDiamond::State state);
 		void showHint();
-        void sleep(int ms) const;
+		//In turbo mode, board changes are applied without animations, so that a
+		//move together with its cascade is resolved in a single timer event.
+		void setTurbo(bool turbo);
 
 	Q_SIGNALS:
 		void boardResized();
 		void numberMoves(int moves);
 		void pendingAnimationsFinished();
 	protected:
+		virtual void drawBackground(QPainter* painter, const QRectF& rect);
 		virtual void timerEvent(QTimerEvent* event);
+	private Q_SLOTS:
+		void prewarmFinished();
+		void sceneResized();
+		void setBackground(const QPixmap& background);
 	private:
 //		QList<QPoint> findCompletedRows();
         QVector<Figure> findFigures();
-        Figure findFigure(QPoint point);
-        QVector<QPoint> findRowH(const QPoint& point);
-        QVector<QPoint> findRowV(const QPoint& point);
 		void getMoves();
         const QVector<Move>& availMoves() const;
 		void removeDiamond(const QPoint& point);
 		void removeJolly(const QPoint& point);
+		void runJob(KDiamond::Job job);
+		void scheduleJobs();
+		void stopJobs();
+		bool canRunJobs() const;
+		void finishMove();
+		int updateBoardTransform();
 
 	private:
 		QList<KDiamond::Job> m_jobQueue;
         QVector<Move> m_availableMoves;
+		KDiamond::MoveIndex m_moveIndex;
+		KDiamond::MoveEvaluator m_moveEvaluator;
 		QList<QPoint> m_swappingDiamonds;
+		int m_seed;
+		std::unique_ptr<cpputils::RandomSource> m_rng;
 		int m_timerId;
+		int m_swapDelay, m_pacingTimerId;
+		int m_resizeTimerId;
+		KDiamond::JobStats m_jobStats;
+		std::chrono::steady_clock::time_point m_animationStart, m_moveStart;
+		bool m_waitingForAnimations, m_moveRunning;
+		int m_cascadeDepth;
+		bool m_swapPaced, m_turbo;
 		KDiamond::Board* m_board;
 		KDiamond::GameState *m_gameState;
 //		Player* m_player; //PROBLEMI CON REFERENZE CIRCOLARI
 		KGamePopupItem *m_messenger;
+		KDiamond::SpritePrewarmer* m_prewarmer;
+		KDiamond::BackgroundRenderer* m_backgroundRenderer;
+		QPixmap m_background;
 };
 
 #endif //KDIAMOND_GAME_H
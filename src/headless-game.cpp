@@ -0,0 +1,35 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "headless-game.h"
+
+KDiamond::HeadlessGame::HeadlessGame(int difficultyIndex)
+	: m_difficultyIndex(difficultyIndex)
+	, m_board(KDiamond::boardSize(difficultyIndex), KDiamond::boardColorCount(difficultyIndex))
+	, m_points(0)
+	, m_earnedMilliseconds(0)
+	, m_moveCount(0)
+{
+}
+
+void KDiamond::HeadlessGame::updateMoves()
+{
+	m_moves.clear();
+	m_moveIndex.update(m_board);
+	m_moveIndex.swaps(m_moves);
+}
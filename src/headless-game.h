@@ -0,0 +1,82 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_HEADLESSGAME_H
+#define KDIAMOND_HEADLESSGAME_H
+
+#include "board-model.h"
+#include "move-evaluator.h"
+#include "move-index.h"
+
+namespace KDiamond
+{
+	//The rules of a complete game without any GUI: moves are applied
+	//instantly, and cascades are resolved within play() (see
+	//KDiamond::MoveEvaluator).
+	class HeadlessGame
+	{
+		public:
+			HeadlessGame(int difficultyIndex);
+
+			//sets up a new board; RNG needs to provide unifInt(n) (see rng.h)
+			template<class RNG> void start(RNG& rng);
+			//Plays the available move with the given index and resolves the cascade.
+			template<class RNG> MoveResult play(int move, RNG& rng);
+
+			int difficultyIndex() const { return m_difficultyIndex; }
+			const BoardModel& board() const { return m_board; }
+			const std::vector<Swap>& moves() const { return m_moves; }
+			bool isFinished() const { return m_moves.empty(); }
+
+			int points() const { return m_points; }
+			int earnedMilliseconds() const { return m_earnedMilliseconds; }
+			int moveCount() const { return m_moveCount; }
+		private:
+			void updateMoves();
+
+			int m_difficultyIndex;
+			BoardModel m_board;
+			MoveIndex m_moveIndex;
+			std::vector<Swap> m_moves;
+			MoveEvaluator m_evaluator;
+			int m_points, m_earnedMilliseconds, m_moveCount;
+	};
+}
+
+template<class RNG> void KDiamond::HeadlessGame::start(RNG& rng)
+{
+	m_board = BoardModel(m_board.size(), m_board.colorCount());
+	m_board.generate(rng);
+	m_moveIndex.invalidate();
+	m_points = m_earnedMilliseconds = m_moveCount = 0;
+	updateMoves();
+}
+
+template<class RNG> KDiamond::MoveResult KDiamond::HeadlessGame::play(int move, RNG& rng)
+{
+	const Swap& swap = m_moves[move];
+	++m_moveCount;
+	m_board.swapCells(swap.from, swap.to);
+	const MoveResult result = m_evaluator.resolve(m_board, rng);
+	m_points += result.points;
+	m_earnedMilliseconds += result.earnedMilliseconds;
+	updateMoves();
+	return result;
+}
+
+#endif // KDIAMOND_HEADLESSGAME_H
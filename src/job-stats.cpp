@@ -0,0 +1,157 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "job-stats.h"
+
+#include <algorithm>
+#include <cstdio>
+
+//bucket 0 holds durations of 0, bucket i holds durations in [2^(i-1), 2^i)
+static int bucket(long long microseconds)
+{
+	if (microseconds <= 0)
+		return 0;
+	return std::min<int>(64 - __builtin_clzll(microseconds), KDiamond::LatencyHistogram::BucketCount - 1);
+}
+
+KDiamond::LatencyHistogram::LatencyHistogram()
+	: m_count(0)
+	, m_total(0)
+	, m_max(0)
+{
+	std::fill(m_buckets, m_buckets + BucketCount, 0);
+}
+
+void KDiamond::LatencyHistogram::add(long long microseconds)
+{
+	++m_buckets[bucket(microseconds)];
+	++m_count;
+	m_total += microseconds;
+	m_max = std::max(m_max, microseconds);
+}
+
+void KDiamond::LatencyHistogram::merge(const LatencyHistogram& other)
+{
+	for (int i = 0; i < BucketCount; ++i)
+		m_buckets[i] += other.m_buckets[i];
+	m_count += other.m_count;
+	m_total += other.m_total;
+	m_max = std::max(m_max, other.m_max);
+}
+
+long long KDiamond::LatencyHistogram::percentile(double fraction) const
+{
+	if (m_count == 0)
+		return 0;
+	const long long rank = std::max<long long>(1, (long long) (fraction * m_count + 0.5));
+	long long seen = 0;
+	for (int i = 0; i < BucketCount; ++i)
+	{
+		seen += m_buckets[i];
+		if (seen >= rank)
+			return std::min(m_max, i ? (1LL << i) - 1 : 0LL);
+	}
+	return m_max;
+}
+
+KDiamond::JobStats::JobStats()
+	: figuresFound(0)
+	, diamondsRemoved(0)
+{
+	std::fill(cascadeDepths, cascadeDepths + MaxCascadeDepth + 1, 0);
+}
+
+void KDiamond::JobStats::addCascade(int depth)
+{
+	++cascadeDepths[std::min(depth, (int) MaxCascadeDepth)];
+}
+
+void KDiamond::JobStats::merge(const JobStats& other)
+{
+	for (int i = 0; i < MaxJobs; ++i)
+		jobs[i].merge(other.jobs[i]);
+	animationWait.merge(other.animationWait);
+	moveLatency.merge(other.moveLatency);
+	figuresFound += other.figuresFound;
+	diamondsRemoved += other.diamondsRemoved;
+	for (int i = 0; i <= MaxCascadeDepth; ++i)
+		cascadeDepths[i] += other.cascadeDepths[i];
+}
+
+//appends one row of the latency table
+static void appendRow(std::string& result, const char* name, const KDiamond::LatencyHistogram& histogram)
+{
+	char line[160];
+	std::snprintf(line, sizeof(line), "  %-24s %8lld %10.1f %9lld %9lld %9lld\n", name, histogram.count(),
+		histogram.meanMicroseconds(), histogram.percentile(0.5), histogram.percentile(0.99), histogram.maxMicroseconds());
+	result += line;
+}
+
+std::string KDiamond::JobStats::summary(const char* const jobNames[MaxJobs]) const
+{
+	std::string result = "latencies in microseconds:\n";
+	char line[160];
+	std::snprintf(line, sizeof(line), "  %-24s %8s %10s %9s %9s %9s\n", "", "count", "mean", "p50", "p99", "max");
+	result += line;
+	for (int i = 0; i < MaxJobs; ++i)
+		if (jobNames[i] && jobs[i].count())
+			appendRow(result, jobNames[i], jobs[i]);
+	appendRow(result, "(waiting for animations)", animationWait);
+	appendRow(result, "(swap until settled)", moveLatency);
+	std::snprintf(line, sizeof(line), "figures found %lld, diamonds removed %lld\ncascade depths", figuresFound, diamondsRemoved);
+	result += line;
+	for (int i = 1; i <= MaxCascadeDepth; ++i)
+		if (cascadeDepths[i])
+		{
+			std::snprintf(line, sizeof(line), " %d%s:%lld", i, i == MaxCascadeDepth ? "+" : "", cascadeDepths[i]);
+			result += line;
+		}
+	result += "\n";
+	return result;
+}
+
+#ifdef UNITTEST
+#include <gtest/gtest.h>
+
+TEST(JobStats, percentiles){
+    KDiamond::LatencyHistogram histogram;
+    EXPECT_EQ(0, histogram.percentile(0.5));
+    for(int i = 1; i <= 100; ++i)
+        histogram.add(i);
+    EXPECT_EQ(100, histogram.count());
+    EXPECT_EQ(100, histogram.maxMicroseconds());
+    EXPECT_DOUBLE_EQ(50.5, histogram.meanMicroseconds());
+    //the median 50 lies in the bucket [32, 64)
+    EXPECT_EQ(63, histogram.percentile(0.5));
+    EXPECT_EQ(100, histogram.percentile(0.99));
+    EXPECT_EQ(1, histogram.percentile(0.0));
+}
+
+TEST(JobStats, merge){
+    KDiamond::JobStats a, b;
+    a.jobs[1].add(10);
+    b.jobs[1].add(1000);
+    b.addCascade(2);
+    b.addCascade(100);
+    a.merge(b);
+    EXPECT_EQ(2, a.jobs[1].count());
+    EXPECT_EQ(1000, a.jobs[1].maxMicroseconds());
+    EXPECT_EQ(1, a.cascadeDepths[2]);
+    EXPECT_EQ(1, a.cascadeDepths[KDiamond::JobStats::MaxCascadeDepth]);
+}
+#endif //UNITTEST
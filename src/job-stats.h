@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_JOBSTATS_H
+#define KDIAMOND_JOBSTATS_H
+
+#include <string>
+
+//NOTE: This header must not depend on Qt, so that it can be used by the engine.
+
+namespace KDiamond
+{
+	//Distribution of durations in buckets of powers of two (in microseconds).
+	class LatencyHistogram
+	{
+		public:
+			static const int BucketCount = 40;
+
+			LatencyHistogram();
+
+			void add(long long microseconds);
+			void merge(const LatencyHistogram& other);
+
+			long long count() const { return m_count; }
+			long long totalMicroseconds() const { return m_total; }
+			long long maxMicroseconds() const { return m_max; }
+			double meanMicroseconds() const { return m_count ? double(m_total) / m_count : 0.0; }
+			//Upper bound of the duration below which the given fraction (0..1) of the
+			//samples lie. The result is exact up to the resolution of the buckets.
+			long long percentile(double fraction) const;
+		private:
+			long long m_buckets[BucketCount];
+			long long m_count, m_total, m_max;
+	};
+
+	//Instrumentation of the job queue of KDiamond::Game: how long each job
+	//computes, how long the queue waits for animations, and how long it takes
+	//from the swap of two diamonds until the board has settled.
+	struct JobStats
+	{
+		//jobs are indexed with their KDiamond::Job value
+		static const int MaxJobs = 8;
+		//deeper cascades are counted in the last bucket
+		static const int MaxCascadeDepth = 16;
+
+		LatencyHistogram jobs[MaxJobs];
+		LatencyHistogram animationWait;
+		LatencyHistogram moveLatency;
+		long long figuresFound, diamondsRemoved;
+		long long cascadeDepths[MaxCascadeDepth + 1];
+
+		JobStats();
+		void addCascade(int depth);
+		void merge(const JobStats& other);
+		//Human-readable table. jobNames[i] is the name of job i (or 0 for unused
+		//job values); jobs which have never run are left out.
+		std::string summary(const char* const jobNames[MaxJobs]) const;
+	};
+}
+
+#endif // KDIAMOND_JOBSTATS_H
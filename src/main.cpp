@@ -16,10 +16,11 @@
  *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  ***************************************************************************/
 
+#include "game.h"
 #include "mainwindow.h"
 #include "settings.h"
+#include "trace.h"
 
-#include <ctime>
 #include <KApplication>
 #include <KAboutData>
 #include <KCmdLineArgs>
@@ -27,16 +28,15 @@
 #include <KLocale>
 #include <KStandardDirs>
 #include <KgDifficulty>
+#include <QFile>
 
-#include <iostream>
-using namespace std;
+#include <cstdio>
 
 static const char description[] = I18N_NOOP("KDiamond, a three-in-a-row game.");
 static const char version[] = "1.4";
 
 int main(int argc, char ** argv)
 {
-	qsrand(time(0));
 	KAboutData about("kdiamond", 0, ki18nc("The application's name", "KDiamond"), version, ki18n(description),
 		KAboutData::License_GPL, ki18n("(C) 2008-2010 Stefan Majewsky and others"), KLocalizedString(), "http://games.kde.org/kdiamond" );
 	about.addAuthor(ki18n("Stefan Majewsky"), ki18n("Original author and current maintainer"), "majewsky@gmx.net");
@@ -46,11 +46,22 @@ int main(int argc, char ** argv)
 	about.addCredit(ki18n("Jeffrey Kelling"), ki18n("Technical consultant"), "kelling.jeffrey@ages-skripte.org");
 	KCmdLineArgs::init(argc, argv, &about);
 
+	KCmdLineOptions options;
+	options.add("trace <file>", ki18n("Write a trace of the game into the given file"));
+	options.add("job-stats", ki18n("Print statistics about the duration of the game's jobs on exit"));
+	KCmdLineArgs::addCmdLineOptions(options);
+
 	KApplication app;
 	KGlobal::locale()->insertCatalog( QLatin1String( "libkdegames" ));
 	//resource directory for KNewStuff2 (this call causes the directory to be created; its existence is necessary for the downloader)
 	KStandardDirs::locateLocal("appdata", "themes/");
 
+	KCmdLineArgs* args = KCmdLineArgs::parsedArgs();
+	if (args->isSet("trace"))
+		KDiamond::Trace::start(QFile::encodeName(args->getOption("trace")).constData());
+	const bool printJobStats = args->isSet("job-stats");
+	args->clear();
+
 	Kg::difficulty()->addStandardLevelRange(
 		KgDifficultyLevel::VeryEasy,
 		KgDifficultyLevel::VeryHard
@@ -65,7 +76,10 @@ int main(int argc, char ** argv)
 	{
 		MainWindow* window = new MainWindow;
 		window->show();
-		cout << "HERE SHOW" << endl;
 	}
-	return app.exec();
+	const int result = app.exec();
+	if (printJobStats)
+		std::fputs(KDiamond::jobStatsSummary(KDiamond::totalJobStats()).c_str(), stderr);
+	KDiamond::Trace::stop();
+	return result;
 }
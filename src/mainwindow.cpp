@@ -42,9 +42,6 @@
 #include <KStandardGameAction>
 #include <KToggleAction>
 
-#include <iostream>
-using namespace std;
-
 MainWindow::MainWindow(QWidget *parent)
 	: KXmlGuiWindow(parent)
 	, m_gameState(new KDiamond::GameState)
@@ -54,6 +51,7 @@ MainWindow::MainWindow(QWidget *parent)
 	, m_newAct(new KActionMenu(KIcon( QLatin1String( "document-new") ), i18nc("new game", "&New" ), this))
 	, m_newTimedAct(new KAction(i18n("Timed game"), this))
 	, m_newUntimedAct(new KAction(i18n("Untimed game"), this))
+	, m_turboAct(new KToggleAction(i18n("&Turbo Mode"), this))
 	, m_selector(KDiamond::renderer()->themeProvider(), KgThemeSelector::EnableNewStuffDownload)
 {
 	KDiamond::renderer()->setDefaultPrimaryView(m_view);
@@ -74,6 +72,10 @@ MainWindow::MainWindow(QWidget *parent)
 	m_hintAct = KStandardGameAction::hint(0, 0, actionCollection());
 	KStandardAction::preferences(&m_selector, SLOT(showAsDialog()), actionCollection());
 	KStandardAction::configureNotifications(this, SLOT(configureNotifications()), actionCollection());
+	m_turboAct->setToolTip(i18n("Apply moves without animations and swap delay"));
+	m_turboAct->setChecked(Settings::turbo());
+	actionCollection()->addAction(QLatin1String("options_turbo"), m_turboAct);
+	connect(m_turboAct, SIGNAL(toggled(bool)), this, SLOT(turboAction(bool)));
 	//difficulty
 	KgDifficultyGUI::init(this);
 	connect(Kg::difficulty(), SIGNAL(currentLevelChanged(const KgDifficultyLevel*)), SLOT(startGameDispatcher()));
@@ -88,7 +90,6 @@ MainWindow::MainWindow(QWidget *parent)
 	connect(m_gameState, SIGNAL(leftTimeChanged(int)), m_infoBar, SLOT(updateRemainingTime(int)));
 	//init game
 	startGameDispatcher();
-	cout << "HERE" << endl;
 }
 
 MainWindow::~MainWindow()
@@ -170,6 +171,14 @@ void MainWindow::pausedAction(bool paused)
 	m_gameState->setState(paused ? KDiamond::Paused : KDiamond::Playing);
 }
 
+void MainWindow::turboAction(bool turbo)
+{
+	Settings::setTurbo(turbo);
+	//apply to the running game as well, new games read it from the settings
+	if (m_game)
+		m_game->setTurbo(turbo);
+}
+
 void MainWindow::configureNotifications()
 {
 	KNotifyConfigWidget::configure(this);
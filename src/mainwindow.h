@@ -25,6 +25,7 @@ class Game;
 class QTime;
 class KAction;
 class KActionMenu;
+class KToggleAction;
 #include <KXmlGuiWindow>
 #include <KgThemeSelector>
 
@@ -52,6 +53,7 @@ class MainWindow : public KXmlGuiWindow
 		void pause(bool paused);
 	protected Q_SLOTS:
 		void pausedAction(bool paused);
+		void turboAction(bool turbo);
 	private:
 		KDiamond::GameState* m_gameState;
 		Game* m_game;
@@ -64,6 +66,7 @@ class MainWindow : public KXmlGuiWindow
 		KAction *m_newUntimedAct;
 		KAction *m_pauseAct;
 		KAction *m_hintAct;
+		KToggleAction *m_turboAct;
 		KgThemeSelector m_selector;
 };
 
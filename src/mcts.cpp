@@ -0,0 +1,239 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "mcts.h"
+
+#include <algorithm>
+#include <cmath>
+
+//limit of KDiamond::MctsOptions::treeDepth
+static const int MaxTreeDepth = 64;
+
+KDiamond::MctsOptions::MctsOptions()
+	: rollouts(2000)
+	, budgetMilliseconds(0)
+	, threads(1)
+	, trees(0)
+	, treeDepth(3)
+	, rolloutMoves(2)
+	, exploration(0.7)
+	, pointsPerSecond(DefaultPointsPerSecond)
+{
+}
+
+KDiamond::MctsStrategy::MctsStrategy(const MctsOptions& options, int seed)
+	: m_options(options)
+	, m_runner(options.threads)
+	, m_rng(seed)
+	, m_lastRollouts(0)
+{
+	if (m_options.rollouts <= 0 && m_options.budgetMilliseconds <= 0)
+		m_options.rollouts = MctsOptions().rollouts;
+	m_options.treeDepth = std::max(1, std::min(MaxTreeDepth, m_options.treeDepth));
+	m_trees.resize(m_options.trees > 0 ? m_options.trees : m_runner.workerCount());
+}
+
+//Picks the child of node to descend into: moves which are legal in the
+//sampled position but not yet in the tree are expanded first (in the order of
+//the number of diamonds they remove immediately), then UCB1 decides.
+int KDiamond::MctsStrategy::select(Tree& tree, int node, const HeadlessGame& game, int& child, bool& expanded) const
+{
+	const std::vector<Swap>& moves = game.moves();
+	const std::vector<int>& children = tree.nodes[node].children;
+	int bestMove = -1;
+	int unexpanded = -1;
+	double bestUcb = -1.0;
+	int legalVisits = 0;
+	//each cell has at most two swaps (with its right and lower neighbor)
+	int legalChildren[2 * KDiamond::MaxCellCount];
+	for (size_t m = 0; m < moves.size(); ++m)
+	{
+		legalChildren[m] = -1;
+		for (size_t c = 0; c < children.size(); ++c)
+		{
+			const Node& n = tree.nodes[children[c]];
+			if (n.from == moves[m].from && n.to == moves[m].to)
+			{
+				legalChildren[m] = children[c];
+				legalVisits += n.visits;
+				break;
+			}
+		}
+		if (legalChildren[m] < 0 && (unexpanded < 0 || moves[m].numToDelete() > moves[unexpanded].numToDelete()))
+			unexpanded = m;
+	}
+	expanded = unexpanded >= 0;
+	if (expanded)
+	{
+		Node newNode;
+		newNode.from = moves[unexpanded].from;
+		newNode.to = moves[unexpanded].to;
+		newNode.visits = 0;
+		newNode.value = 0.0;
+		child = tree.nodes.size();
+		tree.nodes[node].children.push_back(child);
+		tree.nodes.push_back(newNode);
+		return unexpanded;
+	}
+	const double logVisits = std::log(double(std::max(1, legalVisits)));
+	for (size_t m = 0; m < moves.size(); ++m)
+	{
+		const Node& n = tree.nodes[legalChildren[m]];
+		const double ucb = n.value / (n.visits * tree.maxValue)
+			+ m_options.exploration * std::sqrt(logVisits / n.visits);
+		if (ucb > bestUcb)
+		{
+			bestUcb = ucb;
+			bestMove = m;
+			child = legalChildren[m];
+		}
+	}
+	return bestMove;
+}
+
+void KDiamond::MctsStrategy::rollout(Tree& tree, const HeadlessGame& root) const
+{
+	//values are accumulated from the root, and each node is credited with the
+	//value gained from its own move on
+	int path[MaxTreeDepth];
+	double gained[MaxTreeDepth];
+	int length = 0;
+	double value = 0.0;
+	HeadlessGame& game = tree.game;
+	game = root;
+	int node = 0;
+	while (length < m_options.treeDepth && !game.isFinished())
+	{
+		int child;
+		bool expanded;
+		const int move = select(tree, node, game, child, expanded);
+		gained[length] = value;
+		path[length++] = child;
+		value += moveValue(game.play(move, tree.rng), m_options.pointsPerSecond);
+		node = child;
+		if (expanded)
+			break; //leave the tree after an expansion
+	}
+	for (int i = 0; i < m_options.rolloutMoves && !game.isFinished(); ++i)
+		value += moveValue(game.play(tree.rng.unifInt(game.moves().size()), tree.rng), m_options.pointsPerSecond);
+	for (int i = 0; i < length; ++i)
+	{
+		Node& n = tree.nodes[path[i]];
+		const double nodeValue = value - gained[i];
+		++n.visits;
+		n.value += nodeValue;
+		tree.maxValue = std::max(tree.maxValue, nodeValue);
+	}
+	++tree.nodes[0].visits;
+	++tree.rollouts;
+}
+
+void KDiamond::MctsStrategy::search(Tree& tree, const HeadlessGame& root, int rollouts, long long deadline) const
+{
+	tree.nodes.clear();
+	Node rootNode;
+	rootNode.from = rootNode.to = -1;
+	rootNode.visits = 0;
+	rootNode.value = 0.0;
+	tree.nodes.push_back(rootNode);
+	tree.maxValue = 1.0;
+	tree.rollouts = 0;
+	while (rollouts <= 0 || tree.rollouts < rollouts)
+	{
+		rollout(tree, root);
+		if (deadline && clockMicroseconds() >= deadline)
+			break;
+	}
+}
+
+int KDiamond::MctsStrategy::chooseMove(const HeadlessGame& game)
+{
+	const long long deadline = m_options.budgetMilliseconds > 0 ? clockMicroseconds() + 1000LL * m_options.budgetMilliseconds : 0;
+	const int treeCount = m_trees.size();
+	//each tree gets its own stream, so that the result does not depend on the thread which grows it
+	for (int i = 0; i < treeCount; ++i)
+		m_trees[i].rng.seed(1 + m_rng.unifInt(0x7ffffffe));
+	//the rollouts are spread evenly, the first trees play the remainder
+	const int rollouts = m_options.rollouts / treeCount, remainder = m_options.rollouts % treeCount;
+	m_runner.run(treeCount, [&](int worker, int item)
+	{
+		(void) worker;
+		search(m_trees[item], game, m_options.rollouts > 0 ? std::max(1, rollouts + int(item < remainder)) : 0, deadline);
+	});
+	//merge the visit counts of the root moves
+	const std::vector<Swap>& moves = game.moves();
+	std::vector<long long> visits(moves.size(), 0);
+	std::vector<double> values(moves.size(), 0.0);
+	m_lastRollouts = 0;
+	for (int i = 0; i < treeCount; ++i)
+	{
+		const Tree& tree = m_trees[i];
+		m_lastRollouts += tree.rollouts;
+		const std::vector<int>& children = tree.nodes[0].children;
+		for (size_t c = 0; c < children.size(); ++c)
+		{
+			const Node& child = tree.nodes[children[c]];
+			for (size_t m = 0; m < moves.size(); ++m)
+				if (moves[m].from == child.from && moves[m].to == child.to)
+				{
+					visits[m] += child.visits;
+					values[m] += child.value;
+					break;
+				}
+		}
+	}
+	//the most visited move wins, ties are broken by the mean value
+	int best = 0;
+	for (size_t m = 1; m < moves.size(); ++m)
+		if (visits[m] > visits[best] || (visits[m] == visits[best] && visits[m] > 0
+			&& values[m] / visits[m] > values[best] / visits[best]))
+			best = m;
+	return best;
+}
+
+#ifdef UNITTEST
+#include <gtest/gtest.h>
+
+TEST(Mcts, independentOfThreadCount){
+    KDiamond::HeadlessGame game(2);
+    cpputils::ParRap rng(42);
+    game.start(rng);
+    KDiamond::MctsOptions options;
+    options.rollouts = 400;
+    options.trees = 4;
+    options.threads = 1;
+    KDiamond::MctsStrategy single(options, 7);
+    options.threads = 4;
+    KDiamond::MctsStrategy parallel(options, 7);
+    const int move = single.chooseMove(game);
+    ASSERT_GE(move, 0);
+    ASSERT_LT(move, (int) game.moves().size());
+    EXPECT_EQ(move, parallel.chooseMove(game));
+    EXPECT_EQ(400, single.lastRollouts());
+    //the remainder of the rollouts is not lost
+    options.rollouts = 2000;
+    options.trees = 3;
+    KDiamond::MctsStrategy uneven(options, 7);
+    uneven.chooseMove(game);
+    EXPECT_EQ(2000, uneven.lastRollouts());
+    //further decisions run on the threads started by the first one
+    for(int i = 0; i < 3; ++i){
+        EXPECT_EQ(single.chooseMove(game), parallel.chooseMove(game));
+    }
+}
+#endif //UNITTEST
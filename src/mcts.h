@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_MCTS_H
+#define KDIAMOND_MCTS_H
+
+#include "headless-game.h"
+#include "parallel-runner.h"
+#include "rng.h"
+
+#include <vector>
+
+namespace KDiamond
+{
+	struct MctsOptions
+	{
+		int rollouts; //rollouts per decision (in total over all trees, but at least one per tree), 0 for no limit
+		int budgetMilliseconds; //time per decision, 0 for no limit
+		int threads; //search threads, 0 for all hardware threads
+		int trees; //independent search trees, 0 for one per thread
+		int treeDepth; //maximum depth of the search trees
+		int rolloutMoves; //random moves played after leaving the tree
+		double exploration; //UCB1 exploration constant
+		double pointsPerSecond; //see KDiamond::moveValue
+
+		MctsOptions();
+	};
+
+	//Monte Carlo Tree Search over KDiamond::HeadlessGame with root
+	//parallelization: each thread grows its own trees, and the visit counts of
+	//the root moves are summed over all trees to choose the move.
+	//
+	//The refills are chance outcomes. Instead of storing them in the tree, the
+	//trees are open-loop: a node stands for a sequence of moves (identified by
+	//their cells), and each rollout samples new refills while it descends, such
+	//that the statistics of a node average over the refills. Below the root,
+	//only the moves which are legal in the sampled position are considered.
+	//
+	//Either the number of rollouts or the time budget (or both) must be given.
+	//With a fixed number of rollouts and trees, the chosen moves only depend on
+	//the seed, not on the number of threads or the speed of the machine.
+	class MctsStrategy
+	{
+		public:
+			explicit MctsStrategy(const MctsOptions& options = MctsOptions(), int seed = -1);
+			void seed(int seed) { m_rng.seed(seed); }
+			int chooseMove(const HeadlessGame& game);
+
+			//rollouts performed by the last call of chooseMove()
+			int lastRollouts() const { return m_lastRollouts; }
+		private:
+			struct Node
+			{
+				int from, to;
+				int visits;
+				double value; //sum of the values of the rollouts through this node
+				std::vector<int> children; //indices into Tree::nodes
+			};
+			struct Tree
+			{
+				std::vector<Node> nodes;
+				HeadlessGame game; //scratch game for the rollouts
+				cpputils::ParRap rng;
+				double maxValue; //for normalizing the values in UCB1
+				int rollouts;
+
+				Tree() : game(0), rng(1), maxValue(1.0), rollouts(0) {}
+			};
+
+			void search(Tree& tree, const HeadlessGame& root, int rollouts, long long deadline) const;
+			void rollout(Tree& tree, const HeadlessGame& root) const;
+			//returns the index of the move in game.moves(), and its node in child
+			int select(Tree& tree, int node, const HeadlessGame& game, int& child, bool& expanded) const;
+
+			MctsOptions m_options;
+			ParallelRunner m_runner;
+			cpputils::ParRap m_rng;
+			std::vector<Tree> m_trees;
+			int m_lastRollouts;
+	};
+}
+
+#endif // KDIAMOND_MCTS_H
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "move-evaluator.h"
+
+#include <chrono>
+
+long long KDiamond::clockMicroseconds()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+KDiamond::MoveEvaluator::MoveEvaluator()
+	: m_cascade(0)
+{
+}
+
+void KDiamond::MoveEvaluator::removeDiamond(BoardModel& board, int index, MoveResult& result)
+{
+	//see KDiamond::GameState::addPoints
+	result.points += ++m_cascade;
+	result.earnedMilliseconds += 500;
+	if (!board.isEmpty(index))
+	{
+		board.removeCell(index);
+		++result.removed;
+	}
+}
+
+int KDiamond::MoveEvaluator::removeFigures(BoardModel& board, MoveResult& result)
+{
+	const int removedBefore = result.removed;
+	for (int i = 0; i < (int) m_figures.size(); ++i)
+	{
+		const Match& figure = m_figures[i];
+		for (int j = 0; j < figure.count; ++j)
+		{
+			const int index = figure.cells[j];
+			if (board.isEmpty(index))
+				continue; //already removed by another figure or jolly
+			const JollyType jollyType = board.jollyType(index);
+			removeDiamond(board, index, result);
+			//jollies clear their whole row or column (see Game::removeJolly)
+			if (jollyType == JollyType::H)
+				for (int x = 0; x < board.size(); ++x)
+					removeDiamond(board, board.index(x, board.y(index)), result);
+			else if (jollyType == JollyType::V)
+				for (int y = 0; y < board.size(); ++y)
+					removeDiamond(board, board.index(board.x(index), y), result);
+		}
+	}
+	return result.removed - removedBefore;
+}
+
+#ifdef UNITTEST
+#include "headless-game.h"
+#include "rng.h"
+#include <gtest/gtest.h>
+
+TEST(MoveEvaluator, predictsPlay){
+    KDiamond::HeadlessGame game(1);
+    cpputils::ParRap rng(42);
+    game.start(rng);
+    KDiamond::MoveEvaluator evaluator;
+    KDiamond::MaskedRefills masked;
+    for(int i = 0; i < 50 && !game.isFinished(); ++i){
+        const int move = i % game.moves().size();
+        const KDiamond::Swap& swap = game.moves()[move];
+        //a lower bound without knowing the refills
+        const KDiamond::CascadeChain lowerBound = evaluator.evaluate(game.board(), swap, masked);
+        //the exact outcome with a copy of the generator
+        cpputils::ParRap copy(rng);
+        const KDiamond::CascadeChain chain = evaluator.evaluate(game.board(), swap, copy);
+        const KDiamond::MoveResult result = game.play(move, rng);
+        EXPECT_EQ(result.levels, chain.result.levels);
+        EXPECT_EQ(result.removed, chain.result.removed);
+        EXPECT_EQ(result.points, chain.result.points);
+        EXPECT_EQ(result.earnedMilliseconds, chain.result.earnedMilliseconds);
+        EXPECT_LE(lowerBound.result.points, result.points);
+        EXPECT_GE(lowerBound.result.levels, 1);
+        int removed = 0;
+        for(int level = 0; level < KDiamond::MaxChainLevels; ++level){
+            removed += chain.removed[level];
+        }
+        EXPECT_EQ(result.removed, removed);
+    }
+}
+#endif //UNITTEST
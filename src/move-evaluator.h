@@ -0,0 +1,129 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_MOVEEVALUATOR_H
+#define KDIAMOND_MOVEEVALUATOR_H
+
+#include "board-model.h"
+
+namespace KDiamond
+{
+	//outcome of a single move in KDiamond::HeadlessGame
+	struct MoveResult
+	{
+		int levels; //number of cascade levels (1 if no figure was formed by falling diamonds)
+		int removed; //number of removed diamonds
+		int points;
+		int earnedMilliseconds;
+	};
+
+	//Value of a move for the search strategies: its points plus the earned time
+	//(which gives more moves in timed games), weighted with pointsPerSecond.
+	inline double moveValue(const MoveResult& result, double pointsPerSecond)
+	{
+		return result.points + pointsPerSecond * result.earnedMilliseconds / 1000.0;
+	}
+	//default weight of the earned time in KDiamond::moveValue
+	const double DefaultPointsPerSecond = 2.0;
+	//monotonic clock in microseconds, for the time budgets of the search strategies
+	long long clockMicroseconds();
+
+	//deeper cascades are counted in the last entry of KDiamond::CascadeChain::removed
+	const int MaxChainLevels = 16;
+
+	//outcome of a move together with the diamonds removed on each cascade level
+	struct CascadeChain
+	{
+		MoveResult result;
+		int removed[MaxChainLevels];
+	};
+
+	//Refill policy for KDiamond::MoveEvaluator which leaves the refilled cells
+	//empty, such that only the figures are counted which form regardless of
+	//the refills (i.e. a lower bound of the real outcome).
+	struct MaskedRefills
+	{
+	};
+
+	//The cascade rules of the game: figures are removed (jollies clear their
+	//row or column), the diamonds above fall down and the board is refilled,
+	//until no figures are left. The scoring follows KDiamond::GameState::addPoints,
+	//which is called once per removed diamond.
+	//
+	//Besides resolving the moves of KDiamond::HeadlessGame, the evaluator plays
+	//candidate moves on a scratch copy of a board. The copy and the figure
+	//detection on bitboards are cheap, so all available moves of a board can be
+	//evaluated in a few microseconds each.
+	class MoveEvaluator
+	{
+		public:
+			MoveEvaluator();
+
+			//Resolves the cascade on board, which must contain the figures formed
+			//by a move. RNG needs to provide unifInt(n) (see rng.h), or it is
+			//KDiamond::MaskedRefills.
+			template<class RNG> MoveResult resolve(BoardModel& board, RNG& rng, int* removedPerLevel = 0);
+			//Plays the swap on a scratch copy of board and returns its complete
+			//cascade. Pass a copy of the generator which will fill the real board
+			//to predict the exact outcome.
+			template<class RNG> const CascadeChain& evaluate(const BoardModel& board, const Swap& swap, RNG& rng);
+		private:
+			static void refill(BoardModel& board, MaskedRefills& rng) { (void) board; (void) rng; }
+			template<class RNG> static void refill(BoardModel& board, RNG& rng) { board.refill(rng); }
+			//removes the figures in m_figures, and returns the number of removed diamonds
+			int removeFigures(BoardModel& board, MoveResult& result);
+			void removeDiamond(BoardModel& board, int index, MoveResult& result);
+
+			std::vector<Match> m_figures;
+			BoardModel m_scratch;
+			CascadeChain m_chain;
+			int m_cascade;
+	};
+}
+
+template<class RNG> KDiamond::MoveResult KDiamond::MoveEvaluator::resolve(BoardModel& board, RNG& rng, int* removedPerLevel)
+{
+	MoveResult result = { 0, 0, 0, 0 };
+	//start a new cascade
+	m_cascade = 0;
+	while (true)
+	{
+		m_figures.clear();
+		if (!board.findFigures(m_figures))
+			break;
+		const int removed = removeFigures(board, result);
+		if (removedPerLevel)
+			removedPerLevel[result.levels < MaxChainLevels ? result.levels : MaxChainLevels - 1] += removed;
+		++result.levels;
+		board.collapse();
+		refill(board, rng);
+	}
+	return result;
+}
+
+template<class RNG> const KDiamond::CascadeChain& KDiamond::MoveEvaluator::evaluate(const BoardModel& board, const Swap& swap, RNG& rng)
+{
+	m_scratch = board;
+	m_scratch.swapCells(swap.from, swap.to);
+	for (int i = 0; i < MaxChainLevels; ++i)
+		m_chain.removed[i] = 0;
+	m_chain.result = resolve(m_scratch, rng, m_chain.removed);
+	return m_chain;
+}
+
+#endif // KDIAMOND_MOVEEVALUATOR_H
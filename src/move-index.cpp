@@ -0,0 +1,186 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "move-index.h"
+
+#include <cstring>
+
+KDiamond::MoveIndex::MoveIndex()
+	: m_size(0)
+	, m_count(0)
+	, m_evaluatedCount(0)
+	, m_valid(false)
+{
+}
+
+void KDiamond::MoveIndex::invalidate()
+{
+	m_valid = false;
+}
+
+bool KDiamond::MoveIndex::evaluate(const BoardModel& board, int slot)
+{
+	const int from = slot / 2;
+	const int x = board.x(from), y = board.y(from);
+	const bool right = slot % 2 == 0;
+	uint64_t* footprint = &m_footprints[slot * PlaneWords];
+	std::memset(footprint, 0, PlaneWords * sizeof(uint64_t));
+	if ((right && x + 1 >= m_size) || (!right && y + 1 >= m_size))
+		return false; //no neighbor in this direction, this will never change
+	Swap& swap = m_swaps[slot];
+	const bool legal = board.evaluateSwap(from, right ? from + 1 : board.index(x, y + 1), swap);
+	//The result depends on the rows through both cells (at least two cells
+	//in each direction, to see whether a row is formed) and on the cells
+	//around the figures (where the rows end, and where perpendicular rows
+	//would be attached).
+	uint64_t cells[PlaneWords] = { 0 };
+	cells[swap.from >> 6] |= uint64_t(1) << (swap.from & 63);
+	cells[swap.to >> 6] |= uint64_t(1) << (swap.to & 63);
+	for (int i = 0; i < swap.figure1.count; ++i)
+		cells[swap.figure1.cells[i] >> 6] |= uint64_t(1) << (swap.figure1.cells[i] & 63);
+	for (int i = 0; i < swap.figure2.count; ++i)
+		cells[swap.figure2.cells[i] >> 6] |= uint64_t(1) << (swap.figure2.cells[i] & 63);
+	board.crossNeighborhood(cells, footprint);
+	return legal;
+}
+
+void KDiamond::MoveIndex::update(BoardModel& board)
+{
+	const int slotCount = 2 * board.cellCount();
+	if (!m_valid || m_size != board.size())
+	{
+		m_size = board.size();
+		m_legal.assign(slotCount, 0);
+		m_swaps.resize(slotCount);
+		m_footprints.assign(slotCount * PlaneWords, 0);
+		m_count = 0;
+	}
+	const uint64_t* changed = board.changedCells();
+	const int words = board.planeWords();
+	m_evaluatedCount = 0;
+	for (int slot = 0; slot < slotCount; ++slot)
+	{
+		if (m_valid)
+		{
+			const uint64_t* footprint = &m_footprints[slot * PlaneWords];
+			uint64_t affected = 0;
+			for (int i = 0; i < words; ++i)
+				affected |= footprint[i] & changed[i];
+			if (!affected)
+				continue;
+		}
+		++m_evaluatedCount;
+		const bool legal = evaluate(board, slot);
+		m_count += int(legal) - int(m_legal[slot]);
+		m_legal[slot] = legal;
+	}
+	m_valid = true;
+	board.clearChangedCells();
+}
+
+int KDiamond::MoveIndex::swaps(std::vector<Swap>& swaps) const
+{
+	//the slots are ordered by (y, x) while BoardModel::findSwaps iterates over (x, y)
+	for (int x = 0; x < m_size; ++x)
+		for (int y = 0; y < m_size; ++y)
+			for (int direction = 0; direction < 2; ++direction)
+			{
+				const int slot = 2 * (x + y * m_size) + direction;
+				if (m_legal[slot])
+					swaps.push_back(m_swaps[slot]);
+			}
+	return m_count;
+}
+
+#ifdef UNITTEST
+#include "rng.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+    void expectSameFigure(const KDiamond::Match& expected, const KDiamond::Match& actual){
+        EXPECT_EQ(expected.type, actual.type);
+        ASSERT_EQ(expected.count, actual.count);
+        for(int i = 0; i < expected.count; ++i){
+            EXPECT_EQ(expected.cells[i], actual.cells[i]);
+        }
+    }
+
+    //compares the index with a full search of the board
+    void expectSameSwaps(KDiamond::BoardModel& board, KDiamond::MoveIndex& index){
+        index.update(board);
+        std::vector<KDiamond::Swap> expected, actual;
+        board.findSwaps(expected);
+        EXPECT_EQ((int) expected.size(), index.swaps(actual));
+        ASSERT_EQ(expected.size(), actual.size());
+        for(size_t i = 0; i < expected.size(); ++i){
+            EXPECT_EQ(expected[i].from, actual[i].from);
+            EXPECT_EQ(expected[i].to, actual[i].to);
+            expectSameFigure(expected[i].figure1, actual[i].figure1);
+            expectSameFigure(expected[i].figure2, actual[i].figure2);
+        }
+    }
+}
+
+TEST(MoveIndex, incrementalUpdate){
+    cpputils::ParRap rng(31);
+    //8x8 boards fit into one word of the bitboards, 12x12 boards need three
+    const int difficulties[] = { 2, 0 };
+    for(int d = 0; d < 2; ++d){
+        const int difficulty = difficulties[d];
+        KDiamond::BoardModel board(KDiamond::boardSize(difficulty), KDiamond::boardColorCount(difficulty));
+        KDiamond::MoveIndex index;
+        board.generate(rng);
+        expectSameSwaps(board, index);
+        int incremental = 0;
+        for(int move = 0; move < 300; ++move){
+            std::vector<KDiamond::Swap> swaps;
+            if(!board.findSwaps(swaps)){
+                //the game is over, start a new one on the same index
+                board.generate(rng);
+                expectSameSwaps(board, index);
+                continue;
+            }
+            const KDiamond::Swap& swap = swaps[rng.unifInt(swaps.size())];
+            board.swapCells(swap.from, swap.to);
+            std::vector<KDiamond::Match> figures;
+            while(board.findFigures(figures)){
+                for(size_t i = 0; i < figures.size(); ++i){
+                    for(int j = 0; j < figures[i].count; ++j){
+                        if(!board.isEmpty(figures[i].cells[j])){
+                            board.removeCell(figures[i].cells[j]);
+                        }
+                    }
+                }
+                figures.clear();
+                board.collapse();
+                board.refill(rng);
+            }
+            expectSameSwaps(board, index);
+            if(index.evaluatedCount() < 2 * board.cellCount()){
+                ++incremental;
+            }
+            if(::testing::Test::HasFailure()){
+                return;
+            }
+        }
+        //most updates must not have re-evaluated the whole board
+        EXPECT_GT(incremental, 150);
+    }
+}
+#endif //UNITTEST
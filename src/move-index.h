@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_MOVEINDEX_H
+#define KDIAMOND_MOVEINDEX_H
+
+#include "board-model.h"
+
+namespace KDiamond
+{
+	//Keeps track of the legal swaps on a board. After the board has been
+	//changed, update() only re-evaluates those swaps whose result could have
+	//been affected by the changed cells.
+	class MoveIndex
+	{
+		public:
+			MoveIndex();
+
+			//Re-evaluates the swaps affected by the cells changed since the last
+			//update (or all swaps on the first call), and clears the changed
+			//cells of the board.
+			void update(BoardModel& board);
+			//forces a full re-evaluation on the next update
+			void invalidate();
+
+			int count() const { return m_count; }
+			//number of swaps evaluated during the last update
+			int evaluatedCount() const { return m_evaluatedCount; }
+			//Returns the number of legal swaps, which are appended to swaps in the
+			//same order as in KDiamond::BoardModel::findSwaps().
+			int swaps(std::vector<Swap>& swaps) const;
+		private:
+			bool evaluate(const BoardModel& board, int slot);
+
+			int m_size, m_count, m_evaluatedCount;
+			bool m_valid;
+			//the slot of a swap is 2 * from + (0 for a swap to the right, 1 for downwards)
+			std::vector<unsigned char> m_legal;
+			std::vector<Swap> m_swaps;
+			//for each slot, the cells that were read when evaluating the swap
+			std::vector<uint64_t> m_footprints;
+	};
+}
+
+#endif // KDIAMOND_MOVEINDEX_H
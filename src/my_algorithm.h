@@ -43,7 +43,7 @@ int binarySearch(T& vec, double val){  //vec has to be ordered
 }
 
 /// gives back [0,...,n-1]
-vector<int> range(int n){
+inline vector<int> range(int n){
 	vector<int> r(n);
 	for(auto i = 0; i < n ; i++){
 		r[i] = i;
@@ -0,0 +1,224 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "parallel-runner.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	//The remaining items [begin, end) of a worker, packed into a single word
+	//such that the owner (taking from the front) and thieves (taking from the
+	//back) can both update it with a single compare-and-swap. Since an item is
+	//never handed out twice, a range value cannot reappear (no ABA problem).
+	struct WorkRange
+	{
+		std::atomic<uint64_t> range;
+		char padding[64 - sizeof(std::atomic<uint64_t>)]; //keep workers on separate cache lines
+	};
+
+	inline uint64_t pack(uint32_t begin, uint32_t end)
+	{
+		return (uint64_t(begin) << 32) | end;
+	}
+	inline uint32_t rangeBegin(uint64_t range) { return range >> 32; }
+	inline uint32_t rangeEnd(uint64_t range) { return uint32_t(range); }
+	inline uint32_t rangeSize(uint64_t range)
+	{
+		return rangeBegin(range) < rangeEnd(range) ? rangeEnd(range) - rangeBegin(range) : 0;
+	}
+
+	bool takeFront(WorkRange& work, int& item)
+	{
+		uint64_t range = work.range.load(std::memory_order_relaxed);
+		while (rangeSize(range))
+		{
+			const uint32_t begin = rangeBegin(range);
+			if (work.range.compare_exchange_weak(range, pack(begin + 1, rangeEnd(range)), std::memory_order_acq_rel, std::memory_order_relaxed))
+			{
+				item = begin;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool stealBack(WorkRange& victim, uint64_t& stolen)
+	{
+		uint64_t range = victim.range.load(std::memory_order_relaxed);
+		while (rangeSize(range))
+		{
+			const uint32_t begin = rangeBegin(range), end = rangeEnd(range);
+			const uint32_t middle = begin + rangeSize(range) / 2; //the last item can be stolen, too
+			if (victim.range.compare_exchange_weak(range, pack(begin, middle), std::memory_order_acq_rel, std::memory_order_relaxed))
+			{
+				stolen = pack(middle, end);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void work(int worker, std::vector<WorkRange>& ranges, const std::function<void(int, int)>& job)
+	{
+		WorkRange& own = ranges[worker];
+		const int workerCount = ranges.size();
+		while (true)
+		{
+			int item;
+			while (takeFront(own, item))
+				job(worker, item);
+			//find the busiest other worker; if all workers are out of items, the
+			//items still in flight are owned by the workers processing them
+			uint64_t stolen = 0;
+			bool found = false;
+			while (!found)
+			{
+				int victim = -1;
+				uint32_t victimSize = 0;
+				for (int i = 1; i < workerCount; ++i)
+				{
+					const int candidate = (worker + i) % workerCount;
+					const uint32_t size = rangeSize(ranges[candidate].range.load(std::memory_order_relaxed));
+					if (size > victimSize)
+					{
+						victim = candidate;
+						victimSize = size;
+					}
+				}
+				if (victim < 0)
+					return;
+				found = stealBack(ranges[victim], stolen);
+			}
+			//the own range is empty, so no thief will touch it concurrently
+			own.range.store(stolen, std::memory_order_release);
+		}
+	}
+}
+
+//the worker threads 1 .. workerCount() - 1, which wait for the next run()
+struct KDiamond::ParallelRunner::Pool
+{
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable started, finished;
+	//the current run, valid while running > 0
+	std::vector<WorkRange>* ranges;
+	const std::function<void(int, int)>* job;
+	long long generation; //number of runs so far
+	int running; //threads which have not finished the current run
+	bool stopping;
+
+	Pool() : ranges(0), job(0), generation(0), running(0), stopping(false) {}
+
+	void loop(int worker)
+	{
+		long long seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			started.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+			lock.unlock();
+			work(worker, *ranges, *job);
+			lock.lock();
+			if (--running == 0)
+				finished.notify_one();
+		}
+	}
+};
+
+KDiamond::ParallelRunner::ParallelRunner(int threads)
+	: m_workerCount(threads)
+{
+	if (m_workerCount <= 0)
+		m_workerCount = std::thread::hardware_concurrency();
+	if (m_workerCount <= 0)
+		m_workerCount = 1;
+}
+
+KDiamond::ParallelRunner::ParallelRunner(const ParallelRunner& other)
+	: m_workerCount(other.m_workerCount)
+{
+}
+
+KDiamond::ParallelRunner& KDiamond::ParallelRunner::operator=(const ParallelRunner& other)
+{
+	if (m_workerCount != other.m_workerCount)
+	{
+		//the threads are started again by the next run()
+		ParallelRunner stopped(1);
+		std::swap(stopped.m_pool, m_pool);
+		m_workerCount = other.m_workerCount;
+	}
+	return *this;
+}
+
+KDiamond::ParallelRunner::~ParallelRunner()
+{
+	if (!m_pool)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_pool->mutex);
+		m_pool->stopping = true;
+	}
+	m_pool->started.notify_all();
+	for (size_t i = 0; i < m_pool->threads.size(); ++i)
+		m_pool->threads[i].join();
+}
+
+void KDiamond::ParallelRunner::run(int count, const std::function<void(int worker, int item)>& job)
+{
+	std::vector<WorkRange> ranges(m_workerCount);
+	for (int i = 0; i < m_workerCount; ++i)
+	{
+		const uint32_t begin = uint64_t(count) * i / m_workerCount;
+		const uint32_t end = uint64_t(count) * (i + 1) / m_workerCount;
+		ranges[i].range.store(pack(begin, end), std::memory_order_relaxed);
+	}
+	if (m_workerCount == 1 || count <= 1)
+	{
+		work(0, ranges, job);
+		return;
+	}
+	if (!m_pool)
+	{
+		m_pool.reset(new Pool);
+		for (int i = 1; i < m_workerCount; ++i)
+			m_pool->threads.push_back(std::thread(&Pool::loop, m_pool.get(), i));
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_pool->mutex);
+		m_pool->ranges = &ranges;
+		m_pool->job = &job;
+		m_pool->running = m_workerCount - 1;
+		++m_pool->generation;
+	}
+	m_pool->started.notify_all();
+	//the calling thread is worker 0
+	work(0, ranges, job);
+	std::unique_lock<std::mutex> lock(m_pool->mutex);
+	m_pool->finished.wait(lock, [&] { return m_pool->running == 0; });
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_PARALLELRUNNER_H
+#define KDIAMOND_PARALLELRUNNER_H
+
+#include <functional>
+#include <memory>
+
+namespace KDiamond
+{
+	//Runs independent jobs (e.g. simulated games) on several threads.
+	//
+	//Every worker starts with an equal share of the items. When a worker runs
+	//out of items, it steals the upper half of the remaining items of the
+	//busiest other worker, so that a few long games do not leave the other
+	//threads idle. The workers are numbered from 0 to workerCount() - 1, such
+	//that per-worker state (board, RNG, statistics) can be kept in an array and
+	//combined after run() has returned, without any locking.
+	//
+	//The calling thread is worker 0. The other workers are threads which are
+	//started by the first run() and kept until the runner is destroyed, so that
+	//frequent short runs (e.g. one per move of a search) do not create threads.
+	class ParallelRunner
+	{
+		public:
+			//threads = 0 uses all hardware threads
+			explicit ParallelRunner(int threads = 0);
+			//copies have the same number of workers, but their own threads
+			ParallelRunner(const ParallelRunner& other);
+			ParallelRunner& operator=(const ParallelRunner& other);
+			~ParallelRunner();
+
+			int workerCount() const { return m_workerCount; }
+			//Calls job(worker, item) exactly once for each item in [0, count).
+			//Returns after all items have been processed.
+			void run(int count, const std::function<void(int worker, int item)>& job);
+		private:
+			struct Pool;
+
+			int m_workerCount;
+			std::unique_ptr<Pool> m_pool;
+	};
+}
+
+#endif // KDIAMOND_PARALLELRUNNER_H
@@ -0,0 +1,291 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "replay.h"
+#include "board-model.h"
+#include "move-evaluator.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	const char ReplayMagic[6] = { 'K', 'D', 'R', 'P', 'L', 'Y' };
+
+	void appendVarint(std::vector<unsigned char>& data, unsigned int value)
+	{
+		while (value >= 0x80)
+		{
+			data.push_back((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		data.push_back(value);
+	}
+
+	//returns false if the varint is truncated or longer than 32 bits
+	bool readVarint(const unsigned char*& position, const unsigned char* end, unsigned int& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			if (position == end)
+				return false;
+			const unsigned char byte = *position++;
+			value |= (unsigned int) (byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+}
+
+//BEGIN KDiamond::ReplayRecord
+
+void KDiamond::ReplayRecord::begin(int seed, int difficultyIndex)
+{
+	m_seed = seed;
+	m_difficultyIndex = difficultyIndex;
+	m_moveCount = 0;
+	m_moves.clear();
+}
+
+void KDiamond::ReplayRecord::addMove(int from, int to, const MoveResult& result)
+{
+	appendVarint(m_moves, 2 * from + (to == from + 1 ? 0 : 1));
+	appendVarint(m_moves, result.levels);
+	appendVarint(m_moves, result.removed);
+	appendVarint(m_moves, result.points);
+	++m_moveCount;
+}
+
+void KDiamond::ReplayRecord::end(int points)
+{
+	std::vector<unsigned char> header;
+	appendVarint(header, m_seed);
+	header.push_back(m_difficultyIndex);
+	appendVarint(header, m_moveCount);
+	appendVarint(header, points);
+	m_data.clear();
+	appendVarint(m_data, header.size() + m_moves.size());
+	m_data.insert(m_data.end(), header.begin(), header.end());
+	m_data.insert(m_data.end(), m_moves.begin(), m_moves.end());
+}
+
+//END KDiamond::ReplayRecord
+//BEGIN KDiamond::ReplayWriter
+
+KDiamond::ReplayWriter::ReplayWriter()
+	: m_file(0)
+{
+}
+
+KDiamond::ReplayWriter::~ReplayWriter()
+{
+	close();
+}
+
+bool KDiamond::ReplayWriter::open(const char* fileName)
+{
+	close();
+	m_file = std::fopen(fileName, "wb");
+	if (!m_file)
+		return false;
+	unsigned char header[ReplayHeaderSize] = {};
+	std::memcpy(header, ReplayMagic, sizeof(ReplayMagic));
+	header[6] = ReplayVersion;
+	return std::fwrite(header, 1, sizeof(header), m_file) == sizeof(header);
+}
+
+bool KDiamond::ReplayWriter::close()
+{
+	if (!m_file)
+		return true;
+	const bool ok = !std::ferror(m_file);
+	const bool closed = std::fclose(m_file) == 0;
+	m_file = 0;
+	return ok && closed;
+}
+
+void KDiamond::ReplayWriter::write(const ReplayRecord& record)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_file)
+		std::fwrite(record.data(), 1, record.size(), m_file);
+}
+
+//END KDiamond::ReplayWriter
+//BEGIN KDiamond::ReplayGame
+
+bool KDiamond::ReplayGame::nextMove(ReplayMove& move)
+{
+	unsigned int slot, levels, removed, points;
+	if (!readVarint(m_position, m_end, slot)
+		|| !readVarint(m_position, m_end, levels)
+		|| !readVarint(m_position, m_end, removed)
+		|| !readVarint(m_position, m_end, points))
+		return false;
+	move.from = slot / 2;
+	move.to = move.from + (slot % 2 ? m_size : 1);
+	move.levels = levels;
+	move.removed = removed;
+	move.points = points;
+	return true;
+}
+
+//END KDiamond::ReplayGame
+//BEGIN KDiamond::ReplayReader
+
+KDiamond::ReplayReader::ReplayReader()
+	: m_data(0)
+	, m_size(0)
+	, m_position(0)
+	, m_error(false)
+{
+}
+
+KDiamond::ReplayReader::~ReplayReader()
+{
+	close();
+}
+
+bool KDiamond::ReplayReader::open(const char* fileName)
+{
+	close();
+	const int fd = ::open(fileName, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) < 0 || info.st_size < ReplayHeaderSize)
+	{
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); //the mapping stays valid
+	if (data == MAP_FAILED)
+		return false;
+	m_data = static_cast<const unsigned char*>(data);
+	m_size = info.st_size;
+	if (std::memcmp(m_data, ReplayMagic, sizeof(ReplayMagic)) || m_data[6] != ReplayVersion)
+	{
+		close();
+		return false;
+	}
+	madvise(data, m_size, MADV_SEQUENTIAL);
+	rewind();
+	return true;
+}
+
+void KDiamond::ReplayReader::close()
+{
+	if (m_data)
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+	m_data = m_position = 0;
+	m_size = 0;
+	m_error = false;
+}
+
+void KDiamond::ReplayReader::rewind()
+{
+	m_position = m_data ? m_data + ReplayHeaderSize : 0;
+	m_error = false;
+}
+
+bool KDiamond::ReplayReader::nextGame(ReplayGame& game)
+{
+	const unsigned char* end = m_data + m_size;
+	if (!m_data || m_position == end || m_error)
+		return false;
+	unsigned int size, seed, moveCount, points;
+	const unsigned char* position = m_position;
+	m_error = true; //until the record has been validated
+	if (!readVarint(position, end, size) || size > size_t(end - position))
+		return false;
+	const unsigned char* recordEnd = position + size;
+	if (!readVarint(position, recordEnd, seed) || position == recordEnd)
+		return false;
+	const int difficultyIndex = *position++;
+	if (difficultyIndex >= DifficultyCount
+		|| !readVarint(position, recordEnd, moveCount)
+		|| !readVarint(position, recordEnd, points))
+		return false;
+	m_error = false;
+	m_position = recordEnd;
+	game.m_position = position;
+	game.m_end = recordEnd;
+	game.m_seed = seed;
+	game.m_difficultyIndex = difficultyIndex;
+	game.m_moveCount = moveCount;
+	game.m_points = points;
+	game.m_size = boardSize(difficultyIndex);
+	return true;
+}
+
+//END KDiamond::ReplayReader
+
+#ifdef UNITTEST
+#include <gtest/gtest.h>
+
+TEST(Replay, roundTrip){
+    const char* fileName = "replay-test.kdr";
+    KDiamond::ReplayWriter writer;
+    ASSERT_TRUE(writer.open(fileName));
+    KDiamond::ReplayRecord record;
+    for(int game = 0; game < 3; ++game){
+        record.begin(1000000 + game, game);
+        const int size = KDiamond::boardSize(game);
+        for(int move = 0; move < 100 * game; ++move){
+            const KDiamond::MoveResult result = { 1 + move % 3, 3 + move % 5, 6 + move, 500 };
+            record.addMove(move, move + (move % 2 ? size : 1), result);
+        }
+        record.end(4711 * game);
+        writer.write(record);
+    }
+    ASSERT_TRUE(writer.close());
+
+    KDiamond::ReplayReader reader;
+    ASSERT_TRUE(reader.open(fileName));
+    KDiamond::ReplayGame game;
+    for(int i = 0; i < 3; ++i){
+        ASSERT_TRUE(reader.nextGame(game));
+        EXPECT_EQ(1000000 + i, game.seed());
+        EXPECT_EQ(i, game.difficultyIndex());
+        EXPECT_EQ(100 * i, game.moveCount());
+        EXPECT_EQ(4711 * i, game.points());
+        const int size = KDiamond::boardSize(i);
+        KDiamond::ReplayMove move;
+        int count = 0;
+        while(game.nextMove(move)){
+            EXPECT_EQ(count, move.from);
+            EXPECT_EQ(count + (count % 2 ? size : 1), move.to);
+            EXPECT_EQ(1 + count % 3, move.levels);
+            EXPECT_EQ(3 + count % 5, move.removed);
+            EXPECT_EQ(6 + count, move.points);
+            ++count;
+        }
+        EXPECT_EQ(100 * i, count);
+    }
+    EXPECT_FALSE(reader.nextGame(game));
+    EXPECT_FALSE(reader.hasError());
+    reader.close();
+    std::remove(fileName);
+}
+#endif //UNITTEST
@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_REPLAY_H
+#define KDIAMOND_REPLAY_H
+
+#include <cstdio>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+//Compact binary log of complete games, for storing and analysing large numbers
+//of (simulated) games.
+//
+//A replay file starts with the 8-byte header "KDRPLY" followed by the format
+//version and a zero byte. It is followed by one record per game:
+//
+//    varint size           number of bytes in the rest of the record
+//    varint seed
+//    byte   difficulty     see KDiamond::boardSize
+//    varint move count
+//    varint points
+//    per move:
+//        varint slot       2 * from + (0 for a swap to the right, 1 for a swap downwards)
+//        varint levels     see KDiamond::MoveResult
+//        varint removed
+//        varint points
+//
+//Varints are unsigned LEB128 (7 bits per byte, least significant group first).
+
+namespace KDiamond
+{
+	struct MoveResult;
+
+	const int ReplayVersion = 1;
+	const int ReplayHeaderSize = 8;
+
+	//Encodes a single game. The buffer is reused between games.
+	class ReplayRecord
+	{
+		public:
+			void begin(int seed, int difficultyIndex);
+			//to must be the right or lower neighbor of from
+			void addMove(int from, int to, const MoveResult& result);
+			void end(int points);
+
+			const unsigned char* data() const { return &m_data[0]; }
+			size_t size() const { return m_data.size(); }
+		private:
+			std::vector<unsigned char> m_data, m_moves;
+			int m_seed, m_difficultyIndex, m_moveCount;
+	};
+
+	//Appends records to a replay file. write() may be called from several threads.
+	class ReplayWriter
+	{
+		public:
+			ReplayWriter();
+			~ReplayWriter();
+
+			//creates or truncates the file; returns false on failure
+			bool open(const char* fileName);
+			//returns false if an error occurred while writing
+			bool close();
+			void write(const ReplayRecord& record);
+		private:
+			std::FILE* m_file;
+			std::mutex m_mutex;
+	};
+
+	struct ReplayMove
+	{
+		int from, to;
+		int levels, removed, points;
+	};
+
+	//A game inside a memory-mapped replay file. Its moves are decoded on the fly.
+	class ReplayGame
+	{
+		public:
+			int seed() const { return m_seed; }
+			int difficultyIndex() const { return m_difficultyIndex; }
+			int moveCount() const { return m_moveCount; }
+			int points() const { return m_points; }
+
+			//Decodes the next move; returns false after the last move.
+			bool nextMove(ReplayMove& move);
+		private:
+			friend class ReplayReader;
+			const unsigned char* m_position;
+			const unsigned char* m_end;
+			int m_seed, m_difficultyIndex, m_moveCount, m_points, m_size;
+	};
+
+	//Iterates over the games in a replay file, which is memory-mapped instead
+	//of being read into buffers, so that no heap allocation takes place.
+	class ReplayReader
+	{
+		public:
+			ReplayReader();
+			~ReplayReader();
+
+			//returns false if the file cannot be mapped or is not a replay file
+			bool open(const char* fileName);
+			void close();
+			//Returns false at the end of the file, or if the next record is damaged
+			//(see hasError()).
+			bool nextGame(ReplayGame& game);
+			//continues with the first game
+			void rewind();
+			bool hasError() const { return m_error; }
+		private:
+			const unsigned char* m_data;
+			size_t m_size;
+			const unsigned char* m_position;
+			bool m_error;
+	};
+}
+
+#endif // KDIAMOND_REPLAY_H
@@ -31,6 +31,8 @@ using namespace RandomLib;
 
 namespace cpputils{
 
+double logFactorial(int n);
+
 
 /***
 * INTERFACE
@@ -182,7 +184,7 @@ vector<int> permutation(RNG& rng, int n){
     return perm;
 }
 
-int randomSeed(){
+inline int randomSeed(){
     int rdm;
     ifstream urandom("/dev/urandom", ios::in|ios::binary);
     urandom.read((char*)&rdm,4);
@@ -195,7 +197,7 @@ int randomSeed(){
 /********
 Auxiliary functions
 ***********************/
-double logFactorial(int n){
+inline double logFactorial(int n){
     if (n > 254)
     {
         double x = n + 1;
@@ -741,12 +743,45 @@ public:
 
 
 #ifdef RANDOMLIB
-double gaussian(MarsTwist& rng){
+inline double gaussian(MarsTwist& rng){
 	return rng.gauss();
 }
 #endif //RANDOMLIB
 
 
+//Common interface of the generators above, for code that owns a generator
+//without depending on its type (e.g. a game which is reproducible from its seed).
+class RandomSource{
+public:
+	virtual ~RandomSource(){}
+	//seed <= 0 picks a random seed
+	virtual void seed(int seed = -1) = 0;
+	virtual double unifReal() = 0;
+	//uniform int in [0,b)
+	virtual int unifInt(int b) = 0;
+};
+
+template <class RNG>
+class RandomSourceOf : public RandomSource{
+public:
+	RNG rng;
+
+	RandomSourceOf(int seed = -1) : rng(seed) {}
+
+	void seed(int seed = -1){
+		rng.seed(seed);
+	}
+
+	double unifReal(){
+		return rng.unifReal();
+	}
+
+	int unifInt(int b){
+		return rng.unifInt(b);
+	}
+};
+
+
 #ifdef UNITTEST
 #include  <gtest/gtest.h>
 class ParRapTest : public ::testing::Test {
@@ -34,6 +34,19 @@ Settings::Settings(  )
   KConfigSkeleton::ItemBool  *itemUntimed;
   itemUntimed = new KConfigSkeleton::ItemBool( currentGroup(), QLatin1String( "Untimed" ), mUntimed, false );
   addItem( itemUntimed, QLatin1String( "Untimed" ) );
+  KConfigSkeleton::ItemInt  *itemSwapDelay;
+  itemSwapDelay = new KConfigSkeleton::ItemInt( currentGroup(), QLatin1String( "SwapDelay" ), mSwapDelay, 1000 );
+  itemSwapDelay->setMinValue(0);
+  itemSwapDelay->setMaxValue(10000);
+  addItem( itemSwapDelay, QLatin1String( "SwapDelay" ) );
+  KConfigSkeleton::ItemBool  *itemTurbo;
+  itemTurbo = new KConfigSkeleton::ItemBool( currentGroup(), QLatin1String( "Turbo" ), mTurbo, false );
+  addItem( itemTurbo, QLatin1String( "Turbo" ) );
+  KConfigSkeleton::ItemInt  *itemRendererCacheSize;
+  itemRendererCacheSize = new KConfigSkeleton::ItemInt( currentGroup(), QLatin1String( "RendererCacheSize" ), mRendererCacheSize, 10 );
+  itemRendererCacheSize->setMinValue(1);
+  itemRendererCacheSize->setMaxValue(1000);
+  addItem( itemRendererCacheSize, QLatin1String( "RendererCacheSize" ) );
 }
 
 Settings::~Settings()
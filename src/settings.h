@@ -32,6 +32,87 @@ class Settings : public KConfigSkeleton
       return self()->mUntimed;
     }
 
+    /**
+      Set Delay in milliseconds between selecting two diamonds and swapping them (0 for automated runs).
+    */
+    static
+    void setSwapDelay( int v )
+    {
+      if (v < 0)
+      {
+        kDebug() << "setSwapDelay: value " << v << " is less than the minimum value of 0";
+        v = 0;
+      }
+
+      if (v > 10000)
+      {
+        kDebug() << "setSwapDelay: value " << v << " is greater than the maximum value of 10000";
+        v = 10000;
+      }
+
+      if (!self()->isImmutable( QString::fromLatin1( "SwapDelay" ) ))
+        self()->mSwapDelay = v;
+    }
+
+    /**
+      Get Delay in milliseconds between selecting two diamonds and swapping them (0 for automated runs).
+    */
+    static
+    int swapDelay()
+    {
+      return self()->mSwapDelay;
+    }
+
+    /**
+      Set Apply moves without animations (for automated runs).
+    */
+    static
+    void setTurbo( bool v )
+    {
+      if (!self()->isImmutable( QString::fromLatin1( "Turbo" ) ))
+        self()->mTurbo = v;
+    }
+
+    /**
+      Get Apply moves without animations (for automated runs).
+    */
+    static
+    bool turbo()
+    {
+      return self()->mTurbo;
+    }
+
+    /**
+      Set Size of the cache for rendered sprites in MiB.
+    */
+    static
+    void setRendererCacheSize( int v )
+    {
+      if (v < 1)
+      {
+        kDebug() << "setRendererCacheSize: value " << v << " is less than the minimum value of 1";
+        v = 1;
+      }
+
+      if (v > 1000)
+      {
+        kDebug() << "setRendererCacheSize: value " << v << " is greater than the maximum value of 1000";
+        v = 1000;
+      }
+
+      if (!self()->isImmutable( QString::fromLatin1( "RendererCacheSize" ) ))
+        self()->mRendererCacheSize = v;
+    }
+
+    /**
+      Get Size of the cache for rendered sprites in MiB.
+    */
+    static
+    int rendererCacheSize()
+    {
+      return self()->mRendererCacheSize;
+    }
+
   protected:
     Settings();
     friend class SettingsHelper;
@@ -39,6 +120,9 @@ class Settings : public KConfigSkeleton
 
     // Preferences
     bool mUntimed;
+    int mSwapDelay;
+    bool mTurbo;
+    int mRendererCacheSize;
 
   private:
 };
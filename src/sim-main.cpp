@@ -0,0 +1,252 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "parallel-runner.h"
+#include "replay.h"
+#include "sim-options.h"
+#include "simulation.h"
+#include "trace.h"
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+//Batch simulation of complete games without GUI, e.g. to evaluate strategies.
+
+namespace
+{
+	struct Arguments
+	{
+		int games, difficulty, seed;
+		std::string strategy, replay, read;
+		KDiamond::SimulationArguments shared;
+	};
+
+	void usage(const char* program)
+	{
+		std::fprintf(stderr,
+			"Usage: %s [options]\n"
+			"  --games N         number of games per difficulty (default: 1000)\n"
+			"  --difficulty D    difficulty from 0 (very easy) to 4 (very hard), or \"all\" (default)\n"
+			"  --strategy S      \"random\", \"smart[:QI]\", \"expectimax[:DEPTH]\" or \"mcts[:ROLLOUTS]\" (default: random)\n"
+			"  --seed S          seed of the first game, the following games use S+1, S+2, ... (default: 1)\n"
+			"  --replay FILE     write the simulated games into a replay file\n"
+			"  --read FILE       do not simulate, but report the statistics of the games in a replay file\n",
+			program);
+		KDiamond::SimulationArguments::usage();
+	}
+
+	bool parseArguments(int argc, char** argv, Arguments& args)
+	{
+		args.games = 1000;
+		args.difficulty = -1;
+		args.seed = 1;
+		args.strategy = "random";
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* option = argv[i];
+			if (i + 1 >= argc)
+				return false;
+			const char* value = argv[++i];
+			if (!std::strcmp(option, "--games"))
+			{
+				if (!KDiamond::parseInt(value, args.games))
+					return false;
+			}
+			else if (!std::strcmp(option, "--difficulty"))
+			{
+				//only "all" selects every difficulty
+				if (!std::strcmp(value, "all"))
+					args.difficulty = -1;
+				else if (!KDiamond::parseInt(value, args.difficulty) || args.difficulty < 0)
+					return false;
+			}
+			else if (!std::strcmp(option, "--strategy"))
+				args.strategy = value;
+			else if (!std::strcmp(option, "--seed"))
+			{
+				if (!KDiamond::parseInt(value, args.seed))
+					return false;
+			}
+			else if (!std::strcmp(option, "--replay"))
+				args.replay = value;
+			else if (!std::strcmp(option, "--read"))
+				args.read = value;
+			else if (!args.shared.parse(option, value))
+				return false;
+		}
+		//the games use the seeds seed .. seed + games - 1, which must all be valid
+		//(ParRap replaces seeds <= 0 with a random seed)
+		return args.games > 0 && args.seed > 0 && args.games - 1 <= INT_MAX - args.seed && args.difficulty < KDiamond::DifficultyCount
+			&& args.shared.isValid() && KDiamond::isStrategySpec(args.strategy);
+	}
+
+	//a worker thread with the statistics and the replay record of its games
+	template<class Strategy> struct Worker : KDiamond::SimulationWorker<Strategy>
+	{
+		Worker(int difficulty, const Strategy& strategy) : KDiamond::SimulationWorker<Strategy>(difficulty, strategy) {}
+
+		KDiamond::SimulationStats stats;
+		KDiamond::ReplayRecord record;
+	};
+
+	template<class Strategy> KDiamond::SimulationStats simulate(const Arguments& args, int difficulty, const Strategy& prototype, KDiamond::ReplayWriter* writer)
+	{
+		KDiamond::ParallelRunner runner(args.shared.threads);
+		std::vector<std::unique_ptr<Worker<Strategy> > > workers;
+		for (int i = 0; i < runner.workerCount(); ++i)
+			workers.push_back(std::unique_ptr<Worker<Strategy> >(new Worker<Strategy>(difficulty, prototype)));
+		runner.run(args.games, [&](int worker, int item)
+		{
+			Worker<Strategy>& w = *workers[worker];
+			w.play(args.seed + item, args.shared.options, w.stats, writer ? &w.record : 0);
+			if (writer)
+				writer->write(w.record);
+		});
+		KDiamond::SimulationStats stats;
+		for (size_t i = 0; i < workers.size(); ++i)
+			stats.merge(workers[i]->stats);
+		return stats;
+	}
+
+	//simulates the games of one difficulty with the strategy passed by KDiamond::visitStrategy
+	struct Simulation
+	{
+		const Arguments& args;
+		int difficulty;
+		KDiamond::ReplayWriter* writer;
+		KDiamond::SimulationStats stats;
+
+		template<class Strategy> void operator()(const Strategy& strategy)
+		{
+			stats = simulate(args, difficulty, strategy, writer);
+		}
+	};
+
+	void report(int difficulty, const KDiamond::SimulationStats& stats, double seconds)
+	{
+		const double meanPoints = double(stats.points) / stats.games;
+		const double variance = double(stats.pointsSquared) / stats.games - meanPoints * meanPoints;
+		long long levels = 0;
+		for (int i = 0; i <= KDiamond::MaxCascadeDepth; ++i)
+			levels += i * stats.cascadeDepths[i];
+		std::printf("difficulty %d (%dx%d, %d colors)\n", difficulty,
+			KDiamond::boardSize(difficulty), KDiamond::boardSize(difficulty), KDiamond::boardColorCount(difficulty));
+		std::printf("  games          %lld\n", stats.games);
+		std::printf("  points         mean %.2f, stddev %.2f\n", meanPoints, variance > 0 ? std::sqrt(variance) : 0.0);
+		std::printf("  moves          mean %.2f\n", double(stats.moves) / stats.games);
+		std::printf("  removed        mean %.2f per move\n", stats.moves ? double(stats.removed) / stats.moves : 0.0);
+		std::printf("  cascade depth  mean %.3f, max %d\n", stats.moves ? double(levels) / stats.moves : 0.0, stats.maxCascadeDepth);
+		std::printf("  cascade depths");
+		for (int i = 1; i <= KDiamond::MaxCascadeDepth; ++i)
+			if (stats.cascadeDepths[i])
+				std::printf(" %d%s:%lld", i, i == KDiamond::MaxCascadeDepth ? "+" : "", stats.cascadeDepths[i]);
+		std::printf("\n");
+		if (seconds > 0)
+			std::printf("  throughput     %.1f games/s, %.1f moves/s (%.3f s)\n", stats.games / seconds, stats.moves / seconds, seconds);
+	}
+
+	//reports the statistics of the games in a replay file, per difficulty
+	bool readReplays(const char* fileName)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		KDiamond::ReplayReader reader;
+		if (!reader.open(fileName))
+		{
+			std::fprintf(stderr, "Cannot read replay file %s\n", fileName);
+			return false;
+		}
+		KDiamond::SimulationStats stats[KDiamond::DifficultyCount];
+		KDiamond::ReplayGame game;
+		KDiamond::ReplayMove move;
+		while (reader.nextGame(game))
+		{
+			KDiamond::SimulationStats& s = stats[game.difficultyIndex()];
+			while (game.nextMove(move))
+			{
+				const KDiamond::MoveResult result = { move.levels, move.removed, move.points, 0 };
+				s.addMove(result);
+			}
+			s.addGame(game.points());
+		}
+		if (reader.hasError())
+			std::fprintf(stderr, "Replay file %s is damaged, stopped reading at a broken record\n", fileName);
+		const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+		KDiamond::SimulationStats total;
+		for (int difficulty = 0; difficulty < KDiamond::DifficultyCount; ++difficulty)
+			if (stats[difficulty].games)
+			{
+				report(difficulty, stats[difficulty], 0.0);
+				total.merge(stats[difficulty]);
+			}
+		std::printf("read %lld games, %lld moves in %.3f s (%.1f games/s)\n", total.games, total.moves, seconds.count(), total.games / seconds.count());
+		return !reader.hasError();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Arguments args;
+	if (!parseArguments(argc, argv, args))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	if (!args.shared.trace.empty() && !KDiamond::Trace::start(args.shared.trace.c_str()))
+	{
+		std::fprintf(stderr, "Cannot write trace file %s\n", args.shared.trace.c_str());
+		return 1;
+	}
+	if (!args.read.empty())
+	{
+		const bool success = readReplays(args.read.c_str());
+		KDiamond::Trace::stop();
+		return success ? 0 : 1;
+	}
+	KDiamond::ReplayWriter writer;
+	if (!args.replay.empty() && !writer.open(args.replay.c_str()))
+	{
+		std::fprintf(stderr, "Cannot write replay file %s\n", args.replay.c_str());
+		KDiamond::Trace::stop();
+		return 1;
+	}
+	KDiamond::ReplayWriter* replay = args.replay.empty() ? 0 : &writer;
+	args.shared.shareSearchThreads(KDiamond::ParallelRunner(args.shared.threads).workerCount());
+	const int first = args.difficulty < 0 ? 0 : args.difficulty;
+	const int last = args.difficulty < 0 ? KDiamond::DifficultyCount - 1 : args.difficulty;
+	for (int difficulty = first; difficulty <= last; ++difficulty)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Simulation simulation = { args, difficulty, replay, KDiamond::SimulationStats() };
+		KDiamond::visitStrategy(args.strategy, args.shared, simulation);
+		const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+		report(difficulty, simulation.stats, seconds.count());
+	}
+	KDiamond::Trace::stop();
+	if (!writer.close())
+	{
+		std::fprintf(stderr, "Error while writing replay file %s\n", args.replay.c_str());
+		return 1;
+	}
+	return 0;
+}
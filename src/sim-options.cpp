@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "sim-options.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+KDiamond::SimulationArguments::SimulationArguments()
+	: qi(1.0)
+	, threads(0)
+{
+	options.maxMoves = 1000;
+	options.moveMilliseconds = 0;
+}
+
+bool KDiamond::parseInt(const char* value, int& result)
+{
+	char* end;
+	errno = 0;
+	const long number = std::strtol(value, &end, 10);
+	if (end == value || *end || errno == ERANGE || number < INT_MIN || number > INT_MAX)
+		return false;
+	result = number;
+	return true;
+}
+
+bool KDiamond::SimulationArguments::parse(const char* option, const char* value)
+{
+	if (!std::strcmp(option, "--qi"))
+		qi = std::atof(value);
+	else if (!std::strcmp(option, "--depth"))
+		return parseInt(value, expectimax.depth);
+	else if (!std::strcmp(option, "--samples"))
+		return parseInt(value, expectimax.samples);
+	else if (!std::strcmp(option, "--move-budget"))
+		return parseInt(value, expectimax.budgetMilliseconds) && parseInt(value, mcts.budgetMilliseconds);
+	else if (!std::strcmp(option, "--rollouts"))
+		return parseInt(value, mcts.rollouts);
+	else if (!std::strcmp(option, "--search-threads"))
+		return parseInt(value, mcts.threads);
+	else if (!std::strcmp(option, "--trees"))
+		return parseInt(value, mcts.trees);
+	else if (!std::strcmp(option, "--max-moves"))
+		return parseInt(value, options.maxMoves);
+	else if (!std::strcmp(option, "--move-time"))
+		return parseInt(value, options.moveMilliseconds);
+	else if (!std::strcmp(option, "--threads"))
+		return parseInt(value, threads);
+	else if (!std::strcmp(option, "--trace"))
+		trace = value;
+	else
+		return false;
+	return true;
+}
+
+bool KDiamond::SimulationArguments::isValid() const
+{
+	return threads >= 0 && mcts.threads >= 0;
+}
+
+void KDiamond::SimulationArguments::usage()
+{
+	std::fprintf(stderr,
+		"  --qi Q            probability to choose the best move with the smart strategy (default: 1)\n"
+		"  --depth N         search depth of the expectimax strategy (default: 2)\n"
+		"  --samples N       sampled refills per move of the expectimax strategy (default: 4)\n"
+		"  --move-budget MS  thinking time per move of the expectimax and mcts strategies, 0 for no limit (default: 0)\n"
+		"  --rollouts N      rollouts per move of the mcts strategy, 0 for no limit (default: 2000)\n"
+		"  --search-threads N  threads per search of the mcts strategy, 0 to share the hardware threads\n"
+		"                    among the games played in parallel (default: 1)\n"
+		"  --trees N         search trees of the mcts strategy, 0 for one per search thread (default: 0)\n"
+		"  --max-moves N     end each game after N moves, 0 for no limit (default: 1000)\n"
+		"  --move-time MS    simulated time per move for timed games, 0 for untimed games (default: 0)\n"
+		"  --threads N       number of worker threads, 0 for all hardware threads (default: 0)\n"
+		"  --trace FILE      write a trace into FILE\n");
+}
+
+void KDiamond::SimulationArguments::shareSearchThreads(int workerCount)
+{
+	if (mcts.threads == 0)
+		mcts.threads = std::max(1, int(std::thread::hardware_concurrency()) / std::max(1, workerCount));
+}
+
+std::string KDiamond::strategyName(const std::string& spec, const char** parameter)
+{
+	const size_t colon = spec.find(':');
+	*parameter = colon == std::string::npos ? 0 : spec.c_str() + colon + 1;
+	return spec.substr(0, colon);
+}
+
+bool KDiamond::isStrategySpec(const std::string& spec)
+{
+	const char* parameter;
+	const std::string name = strategyName(spec, &parameter);
+	if (name == "random")
+		return !parameter;
+	return (name == "smart" || name == "expectimax" || name == "mcts") && (!parameter || *parameter);
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_SIMOPTIONS_H
+#define KDIAMOND_SIMOPTIONS_H
+
+#include "expectimax.h"
+#include "mcts.h"
+#include "simulation.h"
+#include "strategy.h"
+
+#include <cstdlib>
+#include <string>
+
+namespace KDiamond
+{
+	//Command line options shared by kdiamond-sim and kdiamond-tournament: the
+	//parameters of the strategies, the simulated games and the worker threads.
+	struct SimulationArguments
+	{
+		double qi; //see KDiamond::SmartRandomStrategy
+		ExpectimaxOptions expectimax;
+		MctsOptions mcts;
+		SimulationOptions options;
+		int threads; //game workers, 0 for all hardware threads
+		std::string trace;
+
+		SimulationArguments();
+		//Takes the option with its value if it is one of the shared options.
+		//Returns false for other options.
+		bool parse(const char* option, const char* value);
+		bool isValid() const;
+		//prints the descriptions of the shared options to stderr
+		static void usage();
+		//Searches on all hardware threads in every game worker would oversubscribe
+		//the machine: with --search-threads 0, the hardware threads are shared
+		//among the game workers.
+		void shareSearchThreads(int workerCount);
+	};
+
+	//Parses a decimal integer in the range of int. Returns false if value is
+	//not a number, has trailing characters or does not fit.
+	bool parseInt(const char* value, int& result);
+
+	//whether spec is "random", "smart[:QI]", "expectimax[:DEPTH]" or "mcts[:ROLLOUTS]"
+	bool isStrategySpec(const std::string& spec);
+	//Splits spec into the name of the strategy and its parameter (0 if there is none).
+	std::string strategyName(const std::string& spec, const char** parameter);
+
+	//Creates the strategy given by spec (see isStrategySpec()), with the
+	//parameter from spec overriding the options in args, and passes it to
+	//visitor(strategy).
+	template<class Visitor> void visitStrategy(const std::string& spec, const SimulationArguments& args, Visitor& visitor)
+	{
+		const char* parameter;
+		const std::string name = strategyName(spec, &parameter);
+		if (name == "smart")
+		{
+			SmartRandomStrategy strategy(parameter ? std::atof(parameter) : args.qi);
+			visitor(strategy);
+		}
+		else if (name == "expectimax")
+		{
+			ExpectimaxOptions options = args.expectimax;
+			if (parameter)
+				options.depth = std::atoi(parameter);
+			ExpectimaxStrategy strategy(options);
+			visitor(strategy);
+		}
+		else if (name == "mcts")
+		{
+			MctsOptions options = args.mcts;
+			if (parameter)
+				options.rollouts = std::atoi(parameter);
+			MctsStrategy strategy(options);
+			visitor(strategy);
+		}
+		else
+		{
+			RandomStrategy strategy;
+			visitor(strategy);
+		}
+	}
+}
+
+#endif // KDIAMOND_SIMOPTIONS_H
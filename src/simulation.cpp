@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "simulation.h"
+
+#include <algorithm>
+#include <cstring>
+
+KDiamond::SimulationStats::SimulationStats()
+	: games(0)
+	, moves(0)
+	, points(0)
+	, removed(0)
+	, pointsSquared(0)
+	, maxCascadeDepth(0)
+{
+	std::memset(cascadeDepths, 0, sizeof(cascadeDepths));
+}
+
+void KDiamond::SimulationStats::addMove(const MoveResult& result)
+{
+	++moves;
+	removed += result.removed;
+	++cascadeDepths[std::min(result.levels, MaxCascadeDepth)];
+	maxCascadeDepth = std::max(maxCascadeDepth, result.levels);
+}
+
+void KDiamond::SimulationStats::addGame(int gamePoints)
+{
+	++games;
+	points += gamePoints;
+	pointsSquared += (long long) gamePoints * gamePoints;
+}
+
+void KDiamond::SimulationStats::merge(const SimulationStats& other)
+{
+	games += other.games;
+	moves += other.moves;
+	points += other.points;
+	removed += other.removed;
+	pointsSquared += other.pointsSquared;
+	for (int i = 0; i <= MaxCascadeDepth; ++i)
+		cascadeDepths[i] += other.cascadeDepths[i];
+	maxCascadeDepth = std::max(maxCascadeDepth, other.maxCascadeDepth);
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_SIMULATION_H
+#define KDIAMOND_SIMULATION_H
+
+#include "headless-game.h"
+#include "replay.h"
+#include "rng.h"
+#include "trace.h"
+
+namespace KDiamond
+{
+	//cascades with more levels are counted in the last bucket
+	const int MaxCascadeDepth = 16;
+
+	struct SimulationOptions
+	{
+		int maxMoves; //0 means no limit
+		int moveMilliseconds; //simulated time per move for timed games, 0 for untimed games
+	};
+
+	//Statistics over a number of simulated games, which can be merged.
+	struct SimulationStats
+	{
+		//integral sums, so that merging gives the same result in any order
+		long long games, moves, points, removed, pointsSquared;
+		long long cascadeDepths[MaxCascadeDepth + 1];
+		int maxCascadeDepth;
+
+		SimulationStats();
+		void addMove(const MoveResult& result);
+		void addGame(int points);
+		void merge(const SimulationStats& other);
+	};
+
+	//Plays a complete game with the given strategy. The board and the refills
+	//are determined by the seed alone, so that different strategies can be
+	//compared on the same games. If record is given, the game is encoded into it.
+	template<class Strategy> void simulateGame(HeadlessGame& game, int seed, Strategy& strategy, const SimulationOptions& options, SimulationStats& stats, ReplayRecord* record = 0)
+	{
+		cpputils::ParRap rng(seed);
+		game.start(rng);
+		if (record)
+			record->begin(seed, game.difficultyIndex());
+		int elapsedMilliseconds = 0;
+		while (!game.isFinished())
+		{
+			if (options.maxMoves > 0 && game.moveCount() >= options.maxMoves)
+				break;
+			if (options.moveMilliseconds > 0)
+			{
+				//see KDiamond::GameState::update
+				elapsedMilliseconds += options.moveMilliseconds;
+				if (1000 * KDiamond::GameDuration + game.earnedMilliseconds() - elapsedMilliseconds <= 0)
+					break;
+			}
+			const int move = strategy.chooseMove(game);
+			const Swap& swap = game.moves()[move];
+			const int from = swap.from, to = swap.to;
+			const MoveResult result = game.play(move, rng);
+			stats.addMove(result);
+			if (record)
+				record->addMove(from, to, result);
+		}
+		stats.addGame(game.points());
+		KDIAMOND_TRACE(TraceDebug, TraceEngine, "game %d finished: %d moves, %d points", seed, game.moveCount(), game.points());
+		if (record)
+			record->end(game.points());
+	}
+
+	//Seed of the strategy for the game with the given seed. The strategy gets
+	//its own stream, so that the refills only depend on the game seed (and the
+	//results do not depend on the number of threads).
+	inline int strategySeed(int gameSeed)
+	{
+		return gameSeed ^ 0x5bd1e995;
+	}
+
+	//a game and a copy of the strategy, such that a worker thread can play games on its own
+	template<class Strategy> struct SimulationWorker
+	{
+		SimulationWorker(int difficulty, const Strategy& strategy) : game(difficulty), strategy(strategy) {}
+
+		//plays the game with the given seed (see KDiamond::simulateGame)
+		void play(int seed, const SimulationOptions& options, SimulationStats& stats, ReplayRecord* record = 0)
+		{
+			strategy.seed(strategySeed(seed));
+			simulateGame(game, seed, strategy, options, stats, record);
+		}
+
+		HeadlessGame game;
+		Strategy strategy;
+	};
+}
+
+#endif // KDIAMOND_SIMULATION_H
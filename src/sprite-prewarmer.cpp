@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "sprite-prewarmer.h"
+#include "trace.h"
+
+#include <QTimer>
+#include <KGameRenderer>
+#include <KGameRendererClient>
+
+//maximum time for which the game waits for the sprites (in milliseconds)
+static const int PrewarmTimeout = 3000;
+
+class KDiamond::SpritePrewarmer::Client : public KGameRendererClient
+{
+	public:
+		Client(KDiamond::SpritePrewarmer* owner, KGameRenderer* renderer, const QString& spriteKey, int frame, const QSize& size)
+			: KGameRendererClient(renderer, spriteKey)
+			, m_owner(owner)
+			, m_size(size)
+			, m_done(false)
+		{
+			if (frame >= 0)
+				setFrame(frame);
+			setRenderSize(size);
+		}
+	protected:
+		virtual void receivePixmap(const QPixmap& pixmap)
+		{
+			//ignore pixmaps delivered for the default render size
+			if (m_done || pixmap.size() != m_size)
+				return;
+			m_done = true;
+			m_owner->clientFinished();
+		}
+	private:
+		KDiamond::SpritePrewarmer* m_owner;
+		QSize m_size;
+		bool m_done;
+};
+
+KDiamond::SpritePrewarmer::SpritePrewarmer(KGameRenderer* renderer, QObject* parent)
+	: QObject(parent)
+	, m_renderer(renderer)
+	, m_pending(0)
+	, m_timeout(new QTimer(this))
+{
+	m_timeout->setSingleShot(true);
+	m_timeout->setInterval(PrewarmTimeout);
+	connect(m_timeout, SIGNAL(timeout()), SLOT(slotFinished()));
+}
+
+KDiamond::SpritePrewarmer::~SpritePrewarmer()
+{
+	clear();
+}
+
+bool KDiamond::SpritePrewarmer::isActive() const
+{
+	return !m_clients.isEmpty();
+}
+
+void KDiamond::SpritePrewarmer::start(const QStringList& spriteKeys, const QSize& size)
+{
+	clear();
+	m_timeout->start();
+	foreach (const QString& spriteKey, spriteKeys)
+	{
+		//frameCount is -1 for missing sprites and 0 for non-animated sprites
+		const int frameCount = m_renderer->frameCount(spriteKey);
+		if (frameCount < 0)
+			continue;
+		for (int frame = frameCount > 0 ? 0 : -1; frame < frameCount; ++frame)
+		{
+			//cached sprites may be delivered right away, so count the client first
+			++m_pending;
+			m_clients << new Client(this, m_renderer, spriteKey, frame, size);
+		}
+	}
+	if (m_clients.isEmpty())
+	{
+		m_timeout->stop();
+		emit finished();
+	}
+}
+
+void KDiamond::SpritePrewarmer::clientFinished()
+{
+	//the clients are not deleted while they are delivering their pixmap
+	if (--m_pending == 0)
+		QMetaObject::invokeMethod(this, "slotFinished", Qt::QueuedConnection);
+}
+
+void KDiamond::SpritePrewarmer::slotFinished()
+{
+	//ignore stale calls from a cancelled prewarm
+	if (!isActive() || (m_pending > 0 && m_timeout->isActive()))
+		return;
+	if (m_pending > 0)
+		KDIAMOND_TRACE(TraceError, TraceRendering, "sprite prewarm timed out, %d frames are missing", m_pending);
+	clear();
+	emit finished();
+}
+
+void KDiamond::SpritePrewarmer::clear()
+{
+	m_timeout->stop();
+	qDeleteAll(m_clients);
+	m_clients.clear();
+	m_pending = 0;
+}
+
+#include "sprite-prewarmer.moc"
@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_SPRITEPREWARMER_H
+#define KDIAMOND_SPRITEPREWARMER_H
+
+#include <QObject>
+#include <QSize>
+#include <QStringList>
+
+class QTimer;
+class KGameRenderer;
+
+namespace KDiamond
+{
+	//Renders sprites (including all their animation frames) ahead of time, so
+	//that KGameRenderer has them cached when they are first shown. The sprites
+	//are requested asynchronously, i.e. they are rendered on the worker
+	//threads of the renderer.
+	class SpritePrewarmer : public QObject
+	{
+		Q_OBJECT
+		public:
+			SpritePrewarmer(KGameRenderer* renderer, QObject* parent = 0);
+			virtual ~SpritePrewarmer();
+
+			//Starts rendering all frames of the given sprites at the given size.
+			//A prewarm which is still running is cancelled.
+			void start(const QStringList& spriteKeys, const QSize& size);
+			bool isActive() const;
+		Q_SIGNALS:
+			//emitted when all sprites have been rendered (or when rendering
+			//takes too long, so that a broken theme does not block the game)
+			void finished();
+		private Q_SLOTS:
+			void slotFinished();
+		private:
+			class Client;
+			void clientFinished();
+			void clear();
+
+			KGameRenderer* m_renderer;
+			QList<Client*> m_clients;
+			int m_pending;
+			QTimer* m_timeout;
+	};
+}
+
+#endif // KDIAMOND_SPRITEPREWARMER_H
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_STRATEGY_H
+#define KDIAMOND_STRATEGY_H
+
+#include "headless-game.h"
+#include "rng.h"
+
+namespace KDiamond
+{
+	//Strategies choose one of the available moves of a KDiamond::HeadlessGame.
+	//They must not be called on finished games.
+
+	//picks a random move (like the random player in Game::timerEvent)
+	class RandomStrategy
+	{
+		public:
+			RandomStrategy(int seed = -1) : m_rng(seed) {}
+			void seed(int seed) { m_rng.seed(seed); }
+			int chooseMove(const HeadlessGame& game)
+			{
+				return m_rng.unifInt(game.moves().size());
+			}
+		private:
+			cpputils::ParRap m_rng;
+	};
+
+	//With probability qi, picks the move that removes the most diamonds
+	//immediately, otherwise a random move (like Player::playSmartRandomMove).
+	class SmartRandomStrategy
+	{
+		public:
+			SmartRandomStrategy(double qi, int seed = -1) : m_qi(qi), m_rng(seed) {}
+			void seed(int seed) { m_rng.seed(seed); }
+			int chooseMove(const HeadlessGame& game)
+			{
+				const std::vector<Swap>& moves = game.moves();
+				int argmax = 0;
+				for (size_t i = 1; i < moves.size(); ++i)
+					if (moves[i].numToDelete() > moves[argmax].numToDelete())
+						argmax = i;
+				return m_rng.unifReal() < m_qi ? argmax : m_rng.unifInt(moves.size());
+			}
+		private:
+			double m_qi;
+			cpputils::ParRap m_rng;
+	};
+}
+
+#endif // KDIAMOND_STRATEGY_H
@@ -0,0 +1,64 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_SWAPPATTERNS_H
+#define KDIAMOND_SWAPPATTERNS_H
+
+namespace KDiamond
+{
+	//A local pattern that makes a swap legal. The diamond at the mover cell
+	//arrives at the other end of the swap, where it forms a row of three with
+	//the two partner cells (if these have the same color as the mover).
+	//All offsets are relative to the "from" cell of the swap.
+	struct SwapPattern
+	{
+		signed char moverDx, moverDy;
+		signed char dx1, dy1, dx2, dy2; //partner cells
+	};
+
+	constexpr SwapPattern transposed(SwapPattern p)
+	{
+		return SwapPattern{ p.moverDy, p.moverDx, p.dy1, p.dx1, p.dy2, p.dx2 };
+	}
+
+	const int SwapPatternCount = 8;
+
+	//patterns for a swap with the right neighbor, i.e. from = (0, 0) and to = (1, 0)
+	constexpr SwapPattern RightSwapPatterns[SwapPatternCount] = {
+		//the diamond from (1, 0) arrives at (0, 0)
+		{ 1, 0, -2,  0, -1,  0 }, // x x [.]X
+		{ 1, 0,  0, -2,  0, -1 }, //row above (0, 0)
+		{ 1, 0,  0, -1,  0,  1 }, //(0, 0) in the middle of a vertical row
+		{ 1, 0,  0,  1,  0,  2 }, //row below (0, 0)
+		//the diamond from (0, 0) arrives at (1, 0)
+		{ 0, 0,  2,  0,  3,  0 }, // X[.] x x
+		{ 0, 0,  1, -2,  1, -1 },
+		{ 0, 0,  1, -1,  1,  1 },
+		{ 0, 0,  1,  1,  1,  2 }
+	};
+
+	//patterns for a swap with the lower neighbor, i.e. from = (0, 0) and to = (0, 1)
+	constexpr SwapPattern DownSwapPatterns[SwapPatternCount] = {
+		transposed(RightSwapPatterns[0]), transposed(RightSwapPatterns[1]),
+		transposed(RightSwapPatterns[2]), transposed(RightSwapPatterns[3]),
+		transposed(RightSwapPatterns[4]), transposed(RightSwapPatterns[5]),
+		transposed(RightSwapPatterns[6]), transposed(RightSwapPatterns[7])
+	};
+}
+
+#endif // KDIAMOND_SWAPPATTERNS_H
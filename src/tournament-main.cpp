@@ -0,0 +1,196 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "sim-options.h"
+#include "tournament.h"
+#include "trace.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+//Compares strategies on identical games until the differences are known
+//with the requested precision.
+
+namespace
+{
+	struct Arguments
+	{
+		int difficulty;
+		std::vector<std::string> strategies;
+		KDiamond::TournamentOptions tournament;
+		KDiamond::SimulationArguments shared;
+	};
+
+	void usage(const char* program)
+	{
+		std::fprintf(stderr,
+			"Usage: %s [options] --strategy S1 --strategy S2 ...\n"
+			"  --strategy S      a contestant, the first one is the baseline of the comparisons:\n"
+			"                    \"random\", \"smart[:QI]\", \"expectimax[:DEPTH]\" or \"mcts[:ROLLOUTS]\"\n"
+			"  --difficulty D    difficulty from 0 (very easy) to 4 (very hard) (default: 2)\n"
+			"  --precision P     target half-width of the confidence intervals, relative to the\n"
+			"                    mean points of the baseline (default: 0.02)\n"
+			"  --confidence C    level of the confidence intervals (default: 0.95)\n"
+			"  --resamples N     bootstrap resamples per confidence interval (default: 1000)\n"
+			"  --round N         games per contestant between two checks of the precision (default: 100)\n"
+			"  --min-games N     minimum number of games per contestant (default: 200)\n"
+			"  --max-games N     maximum number of games per contestant (default: 10000)\n"
+			"  --seed S          seed of the first game, the following games use S+1, S+2, ... (default: 1)\n",
+			program);
+		KDiamond::SimulationArguments::usage();
+	}
+
+	bool parseArguments(int argc, char** argv, Arguments& args)
+	{
+		args.difficulty = 2;
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* option = argv[i];
+			if (i + 1 >= argc)
+				return false;
+			const char* value = argv[++i];
+			if (!std::strcmp(option, "--strategy"))
+				args.strategies.push_back(value);
+			else if (!std::strcmp(option, "--difficulty"))
+			{
+				if (!KDiamond::parseInt(value, args.difficulty))
+					return false;
+			}
+			else if (!std::strcmp(option, "--precision"))
+				args.tournament.precision = std::atof(value);
+			else if (!std::strcmp(option, "--confidence"))
+				args.tournament.confidence = std::atof(value);
+			else if (!std::strcmp(option, "--resamples"))
+			{
+				if (!KDiamond::parseInt(value, args.tournament.resamples))
+					return false;
+			}
+			else if (!std::strcmp(option, "--round"))
+			{
+				if (!KDiamond::parseInt(value, args.tournament.roundGames))
+					return false;
+			}
+			else if (!std::strcmp(option, "--min-games"))
+			{
+				if (!KDiamond::parseInt(value, args.tournament.minGames))
+					return false;
+			}
+			else if (!std::strcmp(option, "--max-games"))
+			{
+				if (!KDiamond::parseInt(value, args.tournament.maxGames))
+					return false;
+			}
+			else if (!std::strcmp(option, "--seed"))
+			{
+				if (!KDiamond::parseInt(value, args.tournament.firstSeed))
+					return false;
+			}
+			else if (!args.shared.parse(option, value))
+				return false;
+		}
+		for (size_t i = 0; i < args.strategies.size(); ++i)
+			if (!KDiamond::isStrategySpec(args.strategies[i]))
+				return false;
+		args.tournament.threads = args.shared.threads;
+		const KDiamond::TournamentOptions& t = args.tournament;
+		return !args.strategies.empty() && args.difficulty >= 0 && args.difficulty < KDiamond::DifficultyCount
+			&& t.precision > 0 && t.confidence > 0 && t.confidence < 1 && t.resamples > 0
+			&& t.roundGames > 0 && t.maxGames > 0 && t.minGames <= t.maxGames && t.firstSeed > 0
+			&& t.maxGames - 1 <= INT_MAX - t.firstSeed && args.shared.isValid();
+	}
+
+	//adds the strategy passed by KDiamond::visitStrategy as a contestant
+	struct Registration
+	{
+		const Arguments& args;
+		const std::string& spec;
+		KDiamond::Tournament& tournament;
+
+		template<class Strategy> void operator()(const Strategy& strategy)
+		{
+			tournament.addContestant(KDiamond::makeContestant(spec, args.difficulty, strategy, args.shared.options, tournament.workerCount()));
+		}
+	};
+
+	void printInterval(const char* label, const KDiamond::ConfidenceInterval& interval)
+	{
+		std::printf("  %-15s%.3f [%.3f, %.3f]\n", label, interval.mean, interval.lower, interval.upper);
+	}
+
+	void report(const Arguments& args, const KDiamond::Tournament& tournament, bool precise, double seconds)
+	{
+		const int difficulty = args.difficulty;
+		std::printf("difficulty %d (%dx%d, %d colors), %d games per strategy, %.0f%% confidence intervals\n", difficulty,
+			KDiamond::boardSize(difficulty), KDiamond::boardSize(difficulty), KDiamond::boardColorCount(difficulty),
+			tournament.games(), 100 * args.tournament.confidence);
+		if (!precise)
+			std::printf("precision of %g not reached after %d games\n", args.tournament.precision, tournament.games());
+		const std::vector<KDiamond::ContestantReport> reports = tournament.report();
+		for (size_t i = 0; i < reports.size(); ++i)
+		{
+			const KDiamond::ContestantReport& r = reports[i];
+			std::printf("%s\n", r.name.c_str());
+			printInterval("points", r.points);
+			std::printf("  %-15s%.3f\n", "points stddev", r.pointsStddev);
+			printInterval("moves", r.moves);
+			printInterval("removed/move", r.removedPerMove);
+			printInterval("cascade depth", r.cascadeDepth);
+			std::printf("  %-15s%d\n", "max depth", r.maxCascadeDepth);
+			if (i > 0)
+			{
+				printInterval("vs baseline", r.pointsDifference);
+				std::printf("  %-15s%d wins, %d ties, %d losses\n", "", r.wins, r.ties, r.losses);
+			}
+		}
+		if (seconds > 0)
+			std::printf("%.3f s (%.1f games/s)\n", seconds, tournament.games() * reports.size() / seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Arguments args;
+	if (!parseArguments(argc, argv, args))
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	if (!args.shared.trace.empty() && !KDiamond::Trace::start(args.shared.trace.c_str()))
+	{
+		std::fprintf(stderr, "Cannot write trace file %s\n", args.shared.trace.c_str());
+		return 1;
+	}
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	KDiamond::Tournament tournament(args.tournament);
+	args.shared.shareSearchThreads(tournament.workerCount());
+	for (size_t i = 0; i < args.strategies.size(); ++i)
+	{
+		Registration registration = { args, args.strategies[i], tournament };
+		KDiamond::visitStrategy(args.strategies[i], args.shared, registration);
+	}
+	const bool precise = tournament.run();
+	const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+	report(args, tournament, precise, seconds.count());
+	KDiamond::Trace::stop();
+	return 0;
+}
@@ -0,0 +1,237 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "tournament.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+KDiamond::GameOutcome KDiamond::GameOutcome::fromStats(const SimulationStats& stats)
+{
+	GameOutcome outcome;
+	outcome.points = stats.points;
+	outcome.moves = stats.moves;
+	outcome.removed = stats.removed;
+	outcome.levels = 0;
+	for (int i = 0; i <= MaxCascadeDepth; ++i)
+		outcome.levels += i * stats.cascadeDepths[i];
+	outcome.maxLevels = stats.maxCascadeDepth;
+	return outcome;
+}
+
+KDiamond::TournamentOptions::TournamentOptions()
+	: firstSeed(1)
+	, roundGames(100)
+	, minGames(200)
+	, maxGames(10000)
+	, precision(0.02)
+	, confidence(0.95)
+	, resamples(1000)
+	, threads(0)
+{
+}
+
+KDiamond::ConfidenceInterval KDiamond::bootstrap(const std::vector<double>& numerators, const std::vector<double>* denominators, double confidence, int resamples, int seed)
+{
+	ConfidenceInterval interval = { 0.0, 0.0, 0.0 };
+	const int count = numerators.size();
+	if (!count || resamples <= 0)
+		return interval;
+	double numerator = 0.0, denominator = 0.0;
+	for (int i = 0; i < count; ++i)
+	{
+		numerator += numerators[i];
+		denominator += denominators ? (*denominators)[i] : 1.0;
+	}
+	interval.mean = denominator ? numerator / denominator : 0.0;
+	cpputils::ParRap rng(seed);
+	std::vector<double> estimates(resamples);
+	for (int r = 0; r < resamples; ++r)
+	{
+		numerator = denominator = 0.0;
+		for (int i = 0; i < count; ++i)
+		{
+			const int index = rng.unifInt(count);
+			numerator += numerators[index];
+			denominator += denominators ? (*denominators)[index] : 1.0;
+		}
+		estimates[r] = denominator ? numerator / denominator : 0.0;
+	}
+	std::sort(estimates.begin(), estimates.end());
+	const double tail = (1.0 - confidence) / 2;
+	const int lower = std::max(0, std::min(resamples - 1, int(std::floor(tail * resamples))));
+	const int upper = std::max(0, std::min(resamples - 1, int(std::ceil((1.0 - tail) * resamples)) - 1));
+	interval.lower = estimates[lower];
+	interval.upper = estimates[upper];
+	return interval;
+}
+
+KDiamond::Tournament::Tournament(const TournamentOptions& options)
+	: m_options(options)
+	, m_runner(options.threads)
+	, m_games(0)
+{
+	//the games use the seeds firstSeed .. firstSeed + maxGames - 1, which must
+	//all be valid (ParRap replaces seeds <= 0 with a random seed)
+	m_options.firstSeed = std::max(1, m_options.firstSeed);
+	m_options.maxGames = std::min(m_options.maxGames, INT_MAX - m_options.firstSeed + 1);
+}
+
+void KDiamond::Tournament::addContestant(const Contestant& contestant)
+{
+	m_contestants.push_back(contestant);
+	m_outcomes.push_back(std::vector<GameOutcome>(m_games));
+}
+
+bool KDiamond::Tournament::run()
+{
+	const int contestantCount = m_contestants.size();
+	if (!contestantCount)
+		return false;
+	while (m_games < m_options.maxGames)
+	{
+		const int first = m_games;
+		const int count = std::min(m_options.roundGames, m_options.maxGames - first);
+		for (int i = 0; i < contestantCount; ++i)
+			m_outcomes[i].resize(first + count);
+		//the contestants are interleaved, such that slow contestants are spread
+		//over all workers (each item writes its own outcome, so no locking)
+		m_runner.run(count * contestantCount, [&](int worker, int item)
+		{
+			const int contestant = item % contestantCount, game = first + item / contestantCount;
+			m_outcomes[contestant][game] = m_contestants[contestant].play(worker, m_options.firstSeed + game);
+		});
+		m_games = first + count;
+		KDIAMOND_TRACE(TraceInfo, TraceEngine, "tournament: %d games per contestant", m_games);
+		if (m_games >= m_options.minGames && isPrecise())
+			return true;
+	}
+	return isPrecise();
+}
+
+std::vector<double> KDiamond::Tournament::points(int contestant) const
+{
+	std::vector<double> result(m_games);
+	for (int i = 0; i < m_games; ++i)
+		result[i] = m_outcomes[contestant][i].points;
+	return result;
+}
+
+std::vector<double> KDiamond::Tournament::pointsDifferences(int contestant) const
+{
+	std::vector<double> result(m_games);
+	for (int i = 0; i < m_games; ++i)
+		result[i] = m_outcomes[contestant][i].points - m_outcomes[0][i].points;
+	return result;
+}
+
+bool KDiamond::Tournament::isPrecise() const
+{
+	if (m_contestants.empty() || !m_games)
+		return false;
+	const ConfidenceInterval baseline = bootstrap(points(0), 0, m_options.confidence, m_options.resamples);
+	const double target = m_options.precision * std::fabs(baseline.mean);
+	if (m_contestants.size() == 1)
+		return baseline.halfWidth() <= target;
+	for (size_t i = 1; i < m_contestants.size(); ++i)
+		if (bootstrap(pointsDifferences(i), 0, m_options.confidence, m_options.resamples).halfWidth() > target)
+			return false;
+	return true;
+}
+
+std::vector<KDiamond::ContestantReport> KDiamond::Tournament::report() const
+{
+	std::vector<ContestantReport> reports;
+	for (size_t c = 0; c < m_contestants.size(); ++c)
+	{
+		const std::vector<GameOutcome>& outcomes = m_outcomes[c];
+		std::vector<double> moves(m_games), removed(m_games), levels(m_games);
+		ContestantReport report;
+		report.name = m_contestants[c].name;
+		report.maxCascadeDepth = 0;
+		report.wins = report.ties = report.losses = 0;
+		for (int i = 0; i < m_games; ++i)
+		{
+			moves[i] = outcomes[i].moves;
+			removed[i] = outcomes[i].removed;
+			levels[i] = outcomes[i].levels;
+			report.maxCascadeDepth = std::max(report.maxCascadeDepth, outcomes[i].maxLevels);
+			const int difference = outcomes[i].points - m_outcomes[0][i].points;
+			if (difference > 0)
+				++report.wins;
+			else if (difference < 0)
+				++report.losses;
+			else
+				++report.ties;
+		}
+		const std::vector<double> points = this->points(c);
+		report.points = bootstrap(points, 0, m_options.confidence, m_options.resamples);
+		double squares = 0.0;
+		for (int i = 0; i < m_games; ++i)
+			squares += (points[i] - report.points.mean) * (points[i] - report.points.mean);
+		report.pointsStddev = m_games > 1 ? std::sqrt(squares / (m_games - 1)) : 0.0;
+		report.moves = bootstrap(moves, 0, m_options.confidence, m_options.resamples);
+		report.removedPerMove = bootstrap(removed, &moves, m_options.confidence, m_options.resamples);
+		report.cascadeDepth = bootstrap(levels, &moves, m_options.confidence, m_options.resamples);
+		report.pointsDifference = bootstrap(pointsDifferences(c), 0, m_options.confidence, m_options.resamples);
+		reports.push_back(report);
+	}
+	return reports;
+}
+
+#ifdef UNITTEST
+#include <gtest/gtest.h>
+#include "strategy.h"
+
+TEST(Tournament, bootstrap){
+    std::vector<double> values;
+    for(int i = 0; i < 1000; ++i)
+        values.push_back(i % 10);
+    const KDiamond::ConfidenceInterval interval = KDiamond::bootstrap(values, 0, 0.95, 500);
+    EXPECT_DOUBLE_EQ(4.5, interval.mean);
+    EXPECT_LT(interval.lower, 4.5);
+    EXPECT_GT(interval.upper, 4.5);
+    //the standard error is 2.87 / sqrt(1000) = 0.09
+    EXPECT_NEAR(0.18, interval.halfWidth(), 0.05);
+    const std::vector<double> twice(1000, 2.0);
+    EXPECT_DOUBLE_EQ(2.25, KDiamond::bootstrap(values, &twice, 0.95, 500).mean);
+}
+
+TEST(Tournament, pairedGames){
+    KDiamond::TournamentOptions options;
+    options.roundGames = 20;
+    options.minGames = 40;
+    options.maxGames = 200;
+    options.threads = 2;
+    KDiamond::SimulationOptions simulation = { 100, 0 };
+    KDiamond::Tournament tournament(options);
+    KDiamond::SmartRandomStrategy smart(1.0);
+    tournament.addContestant(KDiamond::makeContestant("a", 2, smart, simulation, tournament.workerCount()));
+    tournament.addContestant(KDiamond::makeContestant("b", 2, smart, simulation, tournament.workerCount()));
+    //identical strategies play identical games, so the difference is exact
+    EXPECT_TRUE(tournament.run());
+    EXPECT_EQ(40, tournament.games());
+    const std::vector<KDiamond::ContestantReport> reports = tournament.report();
+    ASSERT_EQ(2u, reports.size());
+    EXPECT_DOUBLE_EQ(reports[0].points.mean, reports[1].points.mean);
+    EXPECT_DOUBLE_EQ(0.0, reports[1].pointsDifference.halfWidth());
+    EXPECT_EQ(40, reports[1].ties);
+}
+#endif //UNITTEST
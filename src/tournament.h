@@ -0,0 +1,150 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_TOURNAMENT_H
+#define KDIAMOND_TOURNAMENT_H
+
+#include "headless-game.h"
+#include "parallel-runner.h"
+#include "simulation.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace KDiamond
+{
+	//result of one game of a contestant
+	struct GameOutcome
+	{
+		int points, moves, removed;
+		int levels; //sum of the cascade levels of all moves
+		int maxLevels;
+
+		static GameOutcome fromStats(const SimulationStats& stats);
+	};
+
+	//A strategy which takes part in a KDiamond::Tournament. play(worker, seed)
+	//plays the game with the given seed and is called concurrently with distinct
+	//worker numbers (see KDiamond::ParallelRunner).
+	struct Contestant
+	{
+		std::string name;
+		std::function<GameOutcome(int worker, int seed)> play;
+	};
+
+	//Creates a contestant which plays with one copy of the prototype per worker.
+	//The games are played like in kdiamond-sim (see KDiamond::SimulationWorker),
+	//so they are the same as in kdiamond-sim for the same seeds.
+	template<class Strategy> Contestant makeContestant(const std::string& name, int difficulty, const Strategy& prototype, const SimulationOptions& options, int workerCount)
+	{
+		typedef SimulationWorker<Strategy> Worker;
+		std::shared_ptr<std::vector<std::unique_ptr<Worker> > > workers(new std::vector<std::unique_ptr<Worker> >);
+		for (int i = 0; i < workerCount; ++i)
+			workers->push_back(std::unique_ptr<Worker>(new Worker(difficulty, prototype)));
+		Contestant contestant;
+		contestant.name = name;
+		contestant.play = [workers, options](int worker, int seed)
+		{
+			SimulationStats stats;
+			(*workers)[worker]->play(seed, options, stats);
+			return GameOutcome::fromStats(stats);
+		};
+		return contestant;
+	}
+
+	struct TournamentOptions
+	{
+		int firstSeed; //the games use the seeds firstSeed, firstSeed + 1, ... (at most INT_MAX)
+		int roundGames; //games per contestant between two checks of the precision
+		int minGames, maxGames; //per contestant
+		double precision; //target half-width of the confidence intervals, relative to the mean points of the first contestant
+		double confidence; //level of the confidence intervals, e.g. 0.95
+		int resamples; //bootstrap resamples per confidence interval
+		int threads; //0 for all hardware threads
+
+		TournamentOptions();
+	};
+
+	struct ConfidenceInterval
+	{
+		double mean, lower, upper;
+
+		double halfWidth() const { return (upper - lower) / 2; }
+	};
+
+	//Percentile bootstrap of sum(numerators) / sum(denominators), resampling
+	//the indices of the games. Without denominators, this is the mean of the
+	//numerators. The resamples are drawn from the given seed, so the result is
+	//reproducible.
+	ConfidenceInterval bootstrap(const std::vector<double>& numerators, const std::vector<double>* denominators, double confidence, int resamples, int seed = 1);
+
+	//statistics of the games of one contestant
+	struct ContestantReport
+	{
+		std::string name;
+		ConfidenceInterval points, moves, removedPerMove, cascadeDepth;
+		double pointsStddev;
+		int maxCascadeDepth;
+		//paired comparison with the first contestant on the same games
+		ConfidenceInterval pointsDifference;
+		int wins, ties, losses;
+	};
+
+	//Compares strategies on identical sets of games: every contestant plays the
+	//games with the same seeds, i.e. the same initial boards and refill streams.
+	//The points are compared per game (paired differences), which removes the
+	//part of the variance that comes from the seeds. The refills diverge once
+	//the strategies play different moves, though.
+	//
+	//The games are played in rounds on a KDiamond::ParallelRunner. After each
+	//round (and at least minGames games), the tournament stops when the bootstrap
+	//confidence intervals are narrow enough: with several contestants, those of
+	//the point differences to the first contestant, otherwise that of the mean
+	//points of the only contestant. Like kdiamond-sim, the results do not depend
+	//on the number of threads.
+	class Tournament
+	{
+		public:
+			explicit Tournament(const TournamentOptions& options = TournamentOptions());
+
+			//number of workers, for KDiamond::makeContestant
+			int workerCount() const { return m_runner.workerCount(); }
+			void addContestant(const Contestant& contestant);
+
+			//Plays rounds until the requested precision or maxGames is reached.
+			//Returns whether the precision has been reached.
+			bool run();
+			//games per contestant played so far
+			int games() const { return m_games; }
+			std::vector<ContestantReport> report() const;
+		private:
+			bool isPrecise() const;
+			std::vector<double> points(int contestant) const;
+			std::vector<double> pointsDifferences(int contestant) const;
+
+			TournamentOptions m_options;
+			ParallelRunner m_runner;
+			std::vector<Contestant> m_contestants;
+			std::vector<std::vector<GameOutcome> > m_outcomes; //indexed by contestant and game
+			int m_games;
+	};
+}
+
+#endif // KDIAMOND_TOURNAMENT_H
@@ -0,0 +1,289 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#include "trace.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	//capacity of the ring buffer (must be a power of two)
+	const size_t SlotCount = 16384;
+	//longer messages are truncated
+	const int MessageSize = 116;
+	//interval in which the background thread writes the buffer to the file
+	const std::chrono::milliseconds DrainInterval(50);
+
+	//The ring buffer is a bounded queue after Dmitry Vyukov: the sequence
+	//number of a slot tells whether it is free for the writer which claimed the
+	//position pos (sequence == pos) or filled for the reader (sequence == pos + 1).
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		long long time; //in microseconds since KDiamond::Trace::start()
+		unsigned char level, category;
+		char message[MessageSize];
+	};
+
+	struct TraceBuffer
+	{
+		Slot slots[SlotCount];
+		alignas(64) std::atomic<size_t> writePosition;
+		alignas(64) size_t readPosition; //only used by the drain thread
+		std::atomic<long long> dropped;
+		//writers between their check of g_active and the publication of their slot
+		std::atomic<int> writers;
+
+		std::chrono::steady_clock::time_point startTime;
+		FILE* file;
+		std::thread drainThread;
+		std::mutex mutex;
+		std::condition_variable wakeUp;
+		bool stopping;
+	};
+
+	TraceBuffer g_buffer;
+	std::mutex g_startMutex; //serializes start() and stop()
+
+	const char* levelName(int level)
+	{
+		switch (level)
+		{
+			case KDiamond::TraceError: return "error";
+			case KDiamond::TraceInfo: return "info";
+			default: return "debug";
+		}
+	}
+
+	const char* categoryName(int category)
+	{
+		switch (category)
+		{
+			case KDiamond::TraceEngine: return "engine";
+			case KDiamond::TraceJobs: return "jobs";
+			default: return "rendering";
+		}
+	}
+
+	//writes all filled slots to the file (only called from one thread at a time)
+	void drain()
+	{
+		while (true)
+		{
+			Slot& slot = g_buffer.slots[g_buffer.readPosition & (SlotCount - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != g_buffer.readPosition + 1)
+				break;
+			fprintf(g_buffer.file, "%10lld.%06lld %-5s %s: %s\n",
+				slot.time / 1000000, slot.time % 1000000,
+				levelName(slot.level), categoryName(slot.category), slot.message);
+			//release the slot for the writers of the next round
+			slot.sequence.store(g_buffer.readPosition + SlotCount, std::memory_order_release);
+			++g_buffer.readPosition;
+		}
+		fflush(g_buffer.file);
+	}
+
+	void drainLoop()
+	{
+		std::unique_lock<std::mutex> lock(g_buffer.mutex);
+		while (!g_buffer.stopping)
+		{
+			lock.unlock();
+			drain();
+			lock.lock();
+			g_buffer.wakeUp.wait_for(lock, DrainInterval);
+		}
+	}
+}
+
+std::atomic<bool> KDiamond::Trace::g_active(false);
+
+bool KDiamond::Trace::start(const char* fileName)
+{
+	std::lock_guard<std::mutex> startLock(g_startMutex);
+	if (g_active)
+		return false;
+	g_buffer.file = fopen(fileName, "w");
+	if (!g_buffer.file)
+		return false;
+	for (size_t i = 0; i < SlotCount; ++i)
+		g_buffer.slots[i].sequence.store(i, std::memory_order_relaxed);
+	g_buffer.writePosition.store(0, std::memory_order_relaxed);
+	g_buffer.readPosition = 0;
+	g_buffer.dropped.store(0, std::memory_order_relaxed);
+	g_buffer.writers.store(0, std::memory_order_relaxed);
+	g_buffer.startTime = std::chrono::steady_clock::now();
+	g_buffer.stopping = false;
+	g_buffer.drainThread = std::thread(drainLoop);
+	g_active.store(true, std::memory_order_release);
+	return true;
+}
+
+void KDiamond::Trace::stop()
+{
+	std::lock_guard<std::mutex> startLock(g_startMutex);
+	if (!g_active)
+		return;
+	g_active.store(false);
+	//Writers which have seen g_active before it was cleared may still be filling
+	//their slots. Wait for them, so that the final drain gets their messages and
+	//a later start() does not reset slots which are still in use.
+	while (g_buffer.writers.load() > 0)
+		std::this_thread::yield();
+	{
+		std::lock_guard<std::mutex> lock(g_buffer.mutex);
+		g_buffer.stopping = true;
+	}
+	g_buffer.wakeUp.notify_one();
+	g_buffer.drainThread.join();
+	drain();
+	const long long dropped = g_buffer.dropped.load(std::memory_order_relaxed);
+	if (dropped > 0)
+		fprintf(g_buffer.file, "%lld messages dropped because the trace buffer was full\n", dropped);
+	fclose(g_buffer.file);
+	g_buffer.file = 0;
+}
+
+void KDiamond::Trace::write(TraceLevel level, TraceCategory category, const char* format, ...)
+{
+	//Register as a writer before checking g_active again (both sequentially
+	//consistent): either stop() sees this writer and waits for it, or this
+	//writer sees that the trace has been stopped.
+	g_buffer.writers.fetch_add(1);
+	if (!g_active.load())
+	{
+		g_buffer.writers.fetch_sub(1, std::memory_order_release);
+		return;
+	}
+	//claim a free slot
+	size_t position = g_buffer.writePosition.load(std::memory_order_relaxed);
+	Slot* slot;
+	while (true)
+	{
+		slot = &g_buffer.slots[position & (SlotCount - 1)];
+		const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		const long long difference = (long long) sequence - (long long) position;
+		if (difference == 0)
+		{
+			if (g_buffer.writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			//the drain thread has not caught up yet
+			g_buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			g_buffer.writers.fetch_sub(1, std::memory_order_release);
+			return;
+		}
+		else
+			position = g_buffer.writePosition.load(std::memory_order_relaxed);
+	}
+	//fill and publish the slot
+	slot->time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_buffer.startTime).count();
+	slot->level = level;
+	slot->category = category;
+	va_list args;
+	va_start(args, format);
+	vsnprintf(slot->message, MessageSize, format, args);
+	va_end(args);
+	slot->sequence.store(position + 1, std::memory_order_release);
+	g_buffer.writers.fetch_sub(1, std::memory_order_release);
+	//wake up the drain thread early during bursts
+	if ((position & (SlotCount / 4 - 1)) == 0)
+		g_buffer.wakeUp.notify_one();
+}
+
+#ifdef UNITTEST
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    //Reads a trace file. Returns the number of message lines, and the number of
+    //dropped messages reported at its end in dropped.
+    int readTrace(const char* fileName, long long& dropped){
+        std::ifstream file(fileName);
+        std::string line;
+        int lines = 0;
+        dropped = 0;
+        while(std::getline(file, line)){
+            if(line.find(" messages dropped ") != std::string::npos){
+                dropped = std::stoll(line);
+            }else if(line.find("engine: message ") != std::string::npos){
+                ++lines;
+            }
+        }
+        return lines;
+    }
+}
+
+TEST(Trace, concurrentWriters){
+    const char* fileName = "trace-test.log";
+    const int threadCount = 4, writesPerThread = 20000;
+    //the second round starts on the buffer left behind by the first one
+    for(int round = 0; round < 2; ++round){
+        ASSERT_TRUE(KDiamond::Trace::start(fileName));
+        std::vector<std::thread> threads;
+        for(int t = 0; t < threadCount; ++t){
+            threads.push_back(std::thread([t](){
+                for(int i = 0; i < writesPerThread; ++i){
+                    KDiamond::Trace::write(KDiamond::TraceDebug, KDiamond::TraceEngine, "message %d from thread %d", i, t);
+                }
+            }));
+        }
+        for(size_t t = 0; t < threads.size(); ++t){
+            threads[t].join();
+        }
+        KDiamond::Trace::stop();
+        long long dropped;
+        const int lines = readTrace(fileName, dropped);
+        EXPECT_EQ(threadCount * writesPerThread, lines + dropped);
+        EXPECT_GT(lines, 0);
+    }
+    //messages written while the trace stops are either in the file or discarded,
+    //but never leave the buffer in use for the next start()
+    ASSERT_TRUE(KDiamond::Trace::start(fileName));
+    std::atomic<bool> running(true);
+    std::thread writer([&running](){
+        while(running.load()){
+            KDiamond::Trace::write(KDiamond::TraceDebug, KDiamond::TraceEngine, "message during stop");
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    KDiamond::Trace::stop();
+    ASSERT_TRUE(KDiamond::Trace::start(fileName));
+    KDiamond::Trace::stop();
+    running.store(false);
+    writer.join();
+    std::ifstream file(fileName);
+    std::string line;
+    while(std::getline(file, line)){
+        EXPECT_TRUE(line.find("debug engine: message during stop") != std::string::npos
+            || line.find(" messages dropped ") != std::string::npos) << line;
+    }
+    file.close();
+    std::remove(fileName);
+}
+#endif //UNITTEST
@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   Copyright 2008-2010 Stefan Majewsky <majewsky@gmx.net>
+ *
+ *   This program is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2 of the License, or (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ ***************************************************************************/
+
+#ifndef KDIAMOND_TRACE_H
+#define KDIAMOND_TRACE_H
+
+//NOTE: This header must not depend on Qt, it is used by the engine as well.
+
+//Levelled tracing into an in-memory ring buffer, which is written to a file by
+//a background thread (see KDiamond::Trace::start()). Usage:
+//
+//    KDIAMOND_TRACE(TraceDebug, TraceJobs, "removing %d figures", count);
+//
+//Trace points above KDIAMOND_TRACE_LEVEL or outside of KDIAMOND_TRACE_CATEGORIES
+//are removed by the compiler (their arguments are not evaluated either).
+//Release builds keep only the errors by default; both macros can be overridden
+//with -D on the compiler command line.
+
+#include <atomic>
+
+#ifndef KDIAMOND_TRACE_LEVEL
+#	ifdef NDEBUG
+#		define KDIAMOND_TRACE_LEVEL 1
+#	else
+#		define KDIAMOND_TRACE_LEVEL 3
+#	endif
+#endif
+
+#ifndef KDIAMOND_TRACE_CATEGORIES
+#	define KDIAMOND_TRACE_CATEGORIES 0xff
+#endif
+
+#define KDIAMOND_TRACE(level, category, ...) \
+	do { \
+		if (KDiamond::Trace::compiledIn(KDiamond::level, KDiamond::category) && KDiamond::Trace::isActive()) \
+			KDiamond::Trace::write(KDiamond::level, KDiamond::category, __VA_ARGS__); \
+	} while (0)
+
+namespace KDiamond
+{
+	enum TraceLevel
+	{
+		TraceError = 1,
+		TraceInfo = 2,
+		TraceDebug = 3
+	};
+
+	enum TraceCategory
+	{
+		TraceEngine = 1 << 0,
+		TraceJobs = 1 << 1,
+		TraceRendering = 1 << 2
+	};
+
+	namespace Trace
+	{
+		constexpr bool compiledIn(TraceLevel level, TraceCategory category)
+		{
+			return level <= KDIAMOND_TRACE_LEVEL && (category & KDIAMOND_TRACE_CATEGORIES) != 0;
+		}
+
+		//Starts writing the trace to the given file (which is truncated). Returns
+		//false if the file cannot be opened. Before start(), trace points do nothing.
+		bool start(const char* fileName);
+		//Writes the remaining messages and closes the file.
+		void stop();
+		//whether start() has been called (checked by each trace point)
+		extern std::atomic<bool> g_active;
+		inline bool isActive()
+		{
+			return g_active.load(std::memory_order_relaxed);
+		}
+
+		//Formats the message (printf-style) into the ring buffer. This never
+		//blocks: if the buffer is full, the message is dropped and counted.
+		void write(TraceLevel level, TraceCategory category, const char* format, ...)
+#ifdef __GNUC__
+			__attribute__((format(printf, 3, 4)))
+#endif
+		;
+	}
+}
+
+#endif // KDIAMOND_TRACE_H